@@ -0,0 +1,158 @@
+// Разбор каталога при монтировании: прежний конвейер (поле за полем через copy_n, std::erase нулевых записей,
+// отдельный проход с переводом в ole::DirectoryEntry) против load_directories, который за один проход
+// берёт запись wire_cast прямо из сектора и сразу строит ole::DirectoryEntry.
+#include "containerfs/ole.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct MemoryDevice {
+  std::vector<std::byte> bytes;
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) const {
+    if (off > bytes.size() || dst.size() > bytes.size() - off) {
+      return false;
+    }
+    std::memcpy(dst.data(), bytes.data() + off, dst.size());
+    return true;
+  }
+};
+
+// Прежняя раскладка записи: поля в порядке, удобном для чтения, а не в порядке диска
+struct LegacyEntryRaw {
+  std::byte object_type;
+  std::byte color_flag;
+  std::uint16_t name_size_in_bytes;
+  std::array<std::byte, 16> clsid;
+  std::uint32_t left_id;
+  std::uint32_t right_id;
+  std::uint32_t child_id;
+  std::uint32_t state_bits;
+  std::uint32_t starting_sector;
+  std::uint64_t creation_time;
+  std::uint64_t modified_time;
+  std::uint64_t stream_size;
+  std::array<std::byte, 64> name;
+
+  auto operator<=>(const LegacyEntryRaw &) const = default;
+};
+
+template <typename T>
+std::span<const std::byte> take(std::span<const std::byte> src, T &dst) {
+  std::ranges::copy_n(src.begin(), sizeof(T), reinterpret_cast<std::byte *>(std::addressof(dst)));
+  return src.subspan(sizeof(T));
+}
+
+// Прежняя реализация: load_directories + цикл перевода в OleDriver::create
+std::vector<ole::DirectoryEntry> decode_legacy(std::span<const std::byte> bytes, const OleHeader &header) {
+  std::vector<LegacyEntryRaw> raw;
+  raw.reserve(bytes.size() / 128);
+  for (auto view = bytes; not view.empty(); view = view.subspan(128)) {
+    auto &entry = raw.emplace_back();
+    auto rest = view.first(128);
+    rest = take(rest, entry.name);
+    rest = take(rest, entry.name_size_in_bytes);
+    rest = take(rest, entry.object_type);
+    rest = take(rest, entry.color_flag);
+    rest = take(rest, entry.left_id);
+    rest = take(rest, entry.right_id);
+    rest = take(rest, entry.child_id);
+    rest = take(rest, entry.clsid);
+    rest = take(rest, entry.state_bits);
+    rest = take(rest, entry.creation_time);
+    rest = take(rest, entry.modified_time);
+    rest = take(rest, entry.starting_sector);
+    rest = take(rest, entry.stream_size);
+  }
+  std::erase(raw, LegacyEntryRaw{});
+
+  std::vector<ole::DirectoryEntry> dirs;
+  dirs.reserve(raw.size());
+  for (const auto &entry : raw) {
+    ole::DirectoryEntry result{};
+    result.type = static_cast<ole::file_type>(entry.object_type);
+    if (result.type != ole::file_type::unknown_or_unallocated) {
+      result.name = *ole::String::make(entry.name, entry.name_size_in_bytes);
+      result.left_id = entry.left_id;
+      result.right_id = entry.right_id;
+      result.child_id = entry.child_id;
+      result.starting_sector = entry.starting_sector;
+      result.creation_time = entry.creation_time;
+      result.modified_time = entry.modified_time;
+      result.stream_size = header.major_version == 3 ? entry.stream_size & 0xFFFFFFFF : entry.stream_size;
+    }
+    dirs.push_back(result);
+  }
+  return dirs;
+}
+
+// Версия 4: count записей каталога в секторах 0..n-1 подряд, хвост последнего сектора - нули
+MemoryDevice make_directory(std::size_t count, OleHeader &header, std::vector<fat_t> &fat) {
+  constexpr std::size_t kSector = 4096;
+  const auto sectors = (count * 128 + kSector - 1) / kSector;
+  header.major_version = 4;
+  header.sector_shift = 12;
+  header.first_dir_sector = 0;
+  header.num_dir_sectors = static_cast<std::uint32_t>(sectors);
+  fat.resize(sectors);
+  for (std::size_t i = 0; i < sectors; ++i) {
+    fat[i] = i + 1 == sectors ? ENDOFCHAIN : static_cast<fat_t>(i + 1);
+  }
+
+  MemoryDevice dev{std::vector<std::byte>((sectors + 1) * kSector)};
+  for (std::size_t i = 0; i < count; ++i) {
+    DirectoryEntryRaw entry{};
+    const auto name = i == 0 ? std::u16string{u"Root Entry"} : u"stream" + std::u16string(1, static_cast<char16_t>(u'A' + i % 26)) + std::u16string(i % 7, u'x');
+    std::memcpy(entry.name.data(), name.data(), name.size() * 2);
+    entry.name_size_in_bytes = static_cast<std::uint16_t>((name.size() + 1) * 2);
+    entry.object_type = std::byte{static_cast<unsigned char>(i == 0 ? 5 : 2)};
+    entry.left_id = entry.right_id = entry.child_id = ole::NOSTREAM;
+    entry.starting_sector = ENDOFCHAIN;
+    entry.stream_size = i == 0 ? 0 : 100;
+    std::memcpy(dev.bytes.data() + kSector + i * 128, &entry, sizeof(entry));
+  }
+  return dev;
+}
+
+template <typename Decode>
+double measure(int rounds, std::size_t entries, Decode decode) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    decode();
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(rounds) / static_cast<double>(entries);
+}
+
+} // namespace
+
+int main() {
+  constexpr std::size_t kEntries = 50'000;
+  constexpr int kRounds = 50;
+  OleHeader header{};
+  std::vector<fat_t> fat;
+  auto dev = make_directory(kEntries, header, fat);
+
+  std::size_t legacy_count = 0;
+  std::size_t wire_count = 0;
+  const auto legacy = measure(kRounds, kEntries, [&] {
+    // прежний путь тоже сначала читал цепочку каталога в буфер
+    const auto chain = *sector_chain(fat, header.first_dir_sector, header.num_dir_sectors);
+    std::vector<std::byte> buffer(chain.size() * 4096);
+    read_sectors(dev, chain, 4096, buffer);
+    legacy_count = decode_legacy(buffer, header).size();
+  });
+  const auto wire = measure(kRounds, kEntries, [&] { wire_count = load_directories(dev, header, fat)->size(); });
+
+  std::printf("entries: %zu, rounds: %d\n", kEntries, kRounds);
+  std::printf("copy_n pipeline + erase + convert: %6.1f ns/entry (%zu entries)\n", legacy, legacy_count);
+  std::printf("wire_cast single pass:             %6.1f ns/entry (%zu entries)\n", wire, wire_count);
+  std::printf("speedup: %.2fx\n", legacy / wire);
+  return legacy_count == wire_count ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Спуск по дереву каталога: сравнение имён через ole::String::compare (свёртка заранее, блочное сравнение)
+// против прежнего сравнения, которое сворачивало обе строки по одному code unit на каждом узле.
+#include "containerfs/ole_string.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Прежняя реализация ole::String::compare
+std::strong_ordering compare_per_unit(std::u16string_view a, std::u16string_view b) noexcept {
+  if (a.size() != b.size()) {
+    return a.size() <=> b.size();
+  }
+  constexpr auto is_surrogate = [](char16_t ch) noexcept { return ch >= 0xD800 && ch <= 0xDFFF; };
+  auto to_upper_simple = [&](char16_t ch) noexcept -> char16_t {
+    if (is_surrogate(ch)) return ch;
+    if (ch >= u'a' && ch <= u'z') return ch - (u'a' - u'A');
+    return ch;
+  };
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    const char16_t x = to_upper_simple(a[i]);
+    const char16_t y = to_upper_simple(b[i]);
+    if (x != y) {
+      return x <=> y;
+    }
+  }
+  return std::strong_ordering::equal;
+}
+
+// Имена одной длины с общим префиксом - худший случай для посимвольного сравнения
+std::vector<ole::String> make_names(std::size_t count, std::mt19937 &rng) {
+  std::uniform_int_distribution<int> letter(0, 51);
+  std::uniform_int_distribution<std::size_t> length(16, 31);
+  std::vector<ole::String> names;
+  names.reserve(count);
+  while (names.size() < count) {
+    std::u16string name(length(rng), u'x');
+    for (std::size_t i = name.size() / 2; i < name.size(); ++i) {
+      const auto l = letter(rng);
+      name[i] = static_cast<char16_t>(l < 26 ? u'a' + l : u'A' + l - 26);
+    }
+    names.push_back(*ole::String::make(std::u16string_view{name}));
+  }
+  std::ranges::sort(names);
+  names.erase(std::ranges::unique(names).begin(), names.end());
+  return names;
+}
+
+template <typename Less>
+double descend(const std::vector<ole::String> &names, const std::vector<ole::String> &keys, Less less,
+               std::size_t &found) {
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto &key : keys) {
+    // бинарный поиск по отсортированным именам делает те же сравнения, что и спуск по красно-чёрному дереву
+    const auto it = std::ranges::lower_bound(names, key, less);
+    found += it != names.end() && not less(key, *it);
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(keys.size());
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng{42};
+  const auto names = make_names(4096, rng);
+  std::vector<ole::String> keys;
+  std::uniform_int_distribution<std::size_t> pick(0, names.size() - 1);
+  for (int i = 0; i < 1'000'000; ++i) {
+    keys.push_back(names[pick(rng)]);
+  }
+
+  std::size_t found_old = 0;
+  std::size_t found_new = 0;
+  const auto per_unit = descend(names, keys, [](const ole::String &a, const ole::String &b) {
+    return compare_per_unit(a, b) < 0;
+  }, found_old);
+  const auto folded = descend(names, keys, std::less<>{}, found_new);
+
+  std::printf("names: %zu, lookups: %zu\n", names.size(), keys.size());
+  std::printf("per-unit fold:   %6.1f ns/lookup (found %zu)\n", per_unit, found_old);
+  std::printf("prefolded block: %6.1f ns/lookup (found %zu)\n", folded, found_new);
+  std::printf("speedup: %.2fx\n", per_unit / folded);
+  return found_old == found_new ? 0 : 1;
+}
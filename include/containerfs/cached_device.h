@@ -0,0 +1,196 @@
+#pragma once
+
+#include "device_api.h"
+#include "namespace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+CONTAINERFS_NAMESPACE_BEGIN
+
+// Счётчики кэша: сколько блоков нашлось в кэше и сколько пришлось читать с устройства
+struct CacheStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+};
+
+/**
+ * Блочный кэш перед любым ReadableDevice: устройство читается блоками по block_size (кратно сектору, 4096 подходит
+ * обеим версиям OLE), в кэше не больше capacity байт, вытеснение - CLOCK. Блоки разложены по шардам со своими
+ * мьютексами, read_at потокобезопасен для любого Dev; устройство под мьютексом шарда не читается, а если оно
+ * не ConcurrentReadableDevice, чтения сериализуются отдельным мьютексом.
+ */
+template <ReadableDevice Dev>
+class CachedDevice final {
+public:
+  explicit CachedDevice(Dev dev, std::size_t capacity = std::size_t{64} << 20, std::size_t block_size = 4096,
+                        std::size_t shards = 16)
+      : dev_{std::move(dev)}, block_size_{std::max<std::size_t>(block_size, 1)},
+        shard_count_{std::clamp<std::size_t>(shards, 1, std::max<std::size_t>(capacity / block_size_, 1))},
+        shard_capacity_{std::max<std::size_t>(capacity / block_size_ / shard_count_, 1)},
+        shards_{std::make_unique<Shard[]>(shard_count_)} {
+    if constexpr (requires(const Dev& d) { d.size(); }) {
+      device_size_ = dev_.size();
+    }
+  }
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) const {
+    while (not dst.empty()) {
+      const auto block = off / block_size_;
+      const auto skip = static_cast<std::size_t>(off % block_size_);
+      const auto size = std::min(block_size_ - skip, dst.size());
+      if (not read_block(block, skip, dst.first(size))) {
+        return false;
+      }
+      dst = dst.subspan(size);
+      off += size;
+    }
+    return true;
+  }
+
+  // Подсказка уходит устройству под кэшем, сам кэш не заполняется
+  void prefetch(std::uint64_t off, std::uint64_t size) const
+    requires PrefetchableDevice<Dev>
+  {
+    if constexpr (ConcurrentReadableDevice<Dev>) {
+      dev_.prefetch(off, size);
+    } else {
+      std::lock_guard lock{*device_mutex_};
+      dev_.prefetch(off, size);
+    }
+  }
+
+  // Сумма счётчиков всех шардов
+  [[nodiscard]] CacheStats stats() const {
+    CacheStats total;
+    for (std::size_t i = 0; i < shard_count_; ++i) {
+      std::lock_guard lock{shards_[i].mutex};
+      total.hits += shards_[i].stats.hits;
+      total.misses += shards_[i].stats.misses;
+    }
+    return total;
+  }
+
+  [[nodiscard]] std::size_t block_size() const noexcept { return block_size_; }
+  [[nodiscard]] std::size_t capacity() const noexcept { return shard_capacity_ * shard_count_ * block_size_; }
+
+  [[nodiscard]] std::uint64_t size() const noexcept
+    requires requires(const Dev& d) { d.size(); }
+  {
+    return device_size_;
+  }
+
+private:
+  struct Slot {
+    std::uint64_t block = 0;
+    std::size_t size = 0; // последний блок устройства может быть короче block_size
+    bool referenced = false;
+    std::unique_ptr<std::byte[]> data;
+  };
+
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::uint64_t, std::size_t> index; // номер блока -> слот
+    std::vector<Slot> slots;
+    std::size_t hand = 0;
+    CacheStats stats;
+  };
+
+  bool read_block(std::uint64_t block, std::size_t skip, std::span<std::byte> dst) const {
+    auto& shard = shards_[block % shard_count_];
+    {
+      std::lock_guard lock{shard.mutex};
+      if (const auto found = shard.index.find(block); found != shard.index.end()) {
+        auto& slot = shard.slots[found->second];
+        if (skip + dst.size() > slot.size) {
+          return false;
+        }
+        ++shard.stats.hits;
+        slot.referenced = true;
+        std::memcpy(dst.data(), slot.data.get() + skip, dst.size());
+        return true;
+      }
+      ++shard.stats.misses;
+    }
+
+    // промах: блок читается целиком без блокировки шарда, потом кладётся в кэш
+    auto data = std::make_unique_for_overwrite<std::byte[]>(block_size_);
+    const auto size = load(block, {data.get(), block_size_});
+    if (size == 0) {
+      // устройство без size(): блок на конце устройства целиком не читается, читаем только нужное мимо кэша
+      if constexpr (not requires(const Dev& d) { d.size(); }) {
+        return read_device(block * block_size_ + skip, dst);
+      }
+    }
+    if (skip + dst.size() > size) {
+      return false;
+    }
+    std::memcpy(dst.data(), data.get() + skip, dst.size());
+
+    std::lock_guard lock{shard.mutex};
+    if (not shard.index.contains(block)) {
+      insert(shard, block, size, std::move(data));
+    }
+    return true;
+  }
+
+  // Читает блок с устройства, возвращает сколько байт удалось прочитать (0 при ошибке)
+  std::size_t load(std::uint64_t block, std::span<std::byte> dst) const {
+    const auto off = block * block_size_;
+    if constexpr (requires(const Dev& d) { d.size(); }) {
+      // хвост устройства: читаем только то, что есть
+      if (off >= device_size_) {
+        return 0;
+      }
+      dst = dst.first(static_cast<std::size_t>(std::min<std::uint64_t>(dst.size(), device_size_ - off)));
+    }
+
+    return read_device(off, dst) ? dst.size() : 0;
+  }
+
+  bool read_device(std::uint64_t off, std::span<std::byte> dst) const {
+    if constexpr (ConcurrentReadableDevice<Dev>) {
+      return dev_.read_at(off, dst);
+    } else {
+      std::lock_guard lock{*device_mutex_};
+      return dev_.read_at(off, dst);
+    }
+  }
+
+  // CLOCK: стрелка пропускает слоты с битом обращения, сбрасывая его, и занимает первый без него
+  void insert(Shard& shard, std::uint64_t block, std::size_t size, std::unique_ptr<std::byte[]> data) const {
+    if (shard.slots.size() < shard_capacity_) {
+      shard.index.emplace(block, shard.slots.size());
+      shard.slots.push_back({block, size, false, std::move(data)});
+      return;
+    }
+
+    for (;; shard.hand = (shard.hand + 1) % shard.slots.size()) {
+      auto& slot = shard.slots[shard.hand];
+      if (slot.referenced) {
+        slot.referenced = false;
+        continue;
+      }
+      shard.index.erase(slot.block);
+      shard.index.emplace(block, shard.hand);
+      slot = {block, size, false, std::move(data)};
+      shard.hand = (shard.hand + 1) % shard.slots.size();
+      return;
+    }
+  }
+
+  mutable Dev dev_;
+  std::unique_ptr<std::mutex> device_mutex_ = std::make_unique<std::mutex>();
+  std::uint64_t device_size_ = 0; // если Dev умеет size(): размер на момент создания
+  std::size_t block_size_;
+  std::size_t shard_count_;
+  std::size_t shard_capacity_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+CONTAINERFS_NAMESPACE_END
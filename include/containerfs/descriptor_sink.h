@@ -0,0 +1,137 @@
+#pragma once
+
+#include "device_api.h"
+#include "namespace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+CONTAINERFS_NAMESPACE_BEGIN
+
+/**
+ * Запись в открытый дескриптор (файл, сокет, канал) с его текущей позиции; дескриптор блокирующий, sink им не владеет.
+ * copy_from для FileDescriptorDevice копирует силами ядра: сначала copy_file_range(2), затем sendfile(2), который
+ * пишет и в сокеты и каналы. Если ядро отказывает, и для остальных устройств байты идут через view (ViewableDevice)
+ * или буфер и write(2). Выбранный способ запоминается, чтобы не пробовать ядро заново на каждом участке.
+ */
+class DescriptorSink final {
+public:
+  static constexpr std::size_t kBufferSize = std::size_t{1} << 20;
+
+  explicit DescriptorSink(int fd) noexcept : fd_{fd} {}
+
+  template <ReadableDevice Dev>
+  bool copy_from(Dev& dev, std::uint64_t offset, std::uint64_t size) {
+    if constexpr (FileDescriptorDevice<Dev>) {
+      if (not copy_in_kernel(dev.native_handle(), offset, size)) {
+        return false;
+      }
+    }
+    if constexpr (ViewableDevice<Dev>) {
+      if (size != 0) {
+        const auto view = dev.view_at(offset, static_cast<std::size_t>(size));
+        return view.size() == size && write(view);
+      }
+    }
+
+    while (size != 0) {
+      if (not buffer_) {
+        buffer_ = std::make_unique_for_overwrite<std::byte[]>(kBufferSize);
+      }
+      const auto part = static_cast<std::size_t>(std::min<std::uint64_t>(size, kBufferSize));
+      if (not dev.read_at(offset, {buffer_.get(), part}) || not write({buffer_.get(), part})) {
+        return false;
+      }
+      offset += part;
+      size -= part;
+    }
+    return true;
+  }
+
+  // Байты из памяти, например, маленький поток из мини-потока OLE
+  bool write(std::span<const std::byte> src) noexcept {
+    while (not src.empty()) {
+      const auto n = ::write(fd_, src.data(), src.size());
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      src = src.subspan(static_cast<std::size_t>(n));
+      written_ += static_cast<std::uint64_t>(n);
+    }
+    return true;
+  }
+
+  // Сколько байт ушло в дескриптор
+  [[nodiscard]] std::uint64_t written() const noexcept { return written_; }
+
+private:
+  enum class Method { copy_file_range, sendfile, buffered };
+
+  // Один вызов ядра копирует не больше этого (sendfile ограничен 0x7ffff000 байт)
+  static constexpr std::size_t kMaxKernelCopy = std::size_t{1} << 30;
+
+  /**
+   * Копирует сколько получится силами ядра, сдвигая offset и size. false только при настоящей ошибке;
+   * если ядро не поддерживает копирование для этих дескрипторов, остаток достаётся буферному пути.
+   */
+  bool copy_in_kernel(int in, std::uint64_t& offset, std::uint64_t& size) noexcept {
+    while (size != 0 && method_ != Method::buffered) {
+      const auto part = static_cast<std::size_t>(std::min<std::uint64_t>(size, kMaxKernelCopy));
+      ssize_t n = 0;
+      if (method_ == Method::copy_file_range) {
+        auto off = static_cast<off64_t>(offset);
+        n = ::copy_file_range(in, &off, fd_, nullptr, part, 0);
+      } else {
+        auto off = static_cast<off_t>(offset);
+        n = ::sendfile(fd_, in, &off, part);
+      }
+
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0 && unsupported(errno)) {
+        method_ = method_ == Method::copy_file_range ? Method::sendfile : Method::buffered;
+        continue;
+      }
+      // 0 - конец входного файла: диапазон выходит за устройство
+      if (n <= 0) {
+        return false;
+      }
+      offset += static_cast<std::uint64_t>(n);
+      size -= static_cast<std::uint64_t>(n);
+      written_ += static_cast<std::uint64_t>(n);
+    }
+    return true;
+  }
+
+  // Ошибки, после которых стоит попробовать следующий способ: ядро не умеет копировать между такими дескрипторами
+  [[nodiscard]] bool unsupported(int error) const noexcept {
+    switch (error) {
+    case EINVAL:
+    case ENOSYS:
+    case EOPNOTSUPP:
+    case EXDEV:
+      return true;
+    case EBADF: // copy_file_range не пишет в дескриптор с O_APPEND
+      return method_ == Method::copy_file_range;
+    default:
+      return false;
+    }
+  }
+
+  int fd_;
+  Method method_ = Method::copy_file_range;
+  std::unique_ptr<std::byte[]> buffer_;
+  std::uint64_t written_ = 0;
+};
+
+CONTAINERFS_NAMESPACE_END
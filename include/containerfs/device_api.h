@@ -6,6 +6,8 @@
 #include <bit>
 #include <expected>
 #include <filesystem>
+#include <functional>
+#include <memory_resource>
 #include <span>
 #include <vector>
 
@@ -17,6 +19,108 @@ concept ReadableDevice = requires(Dev& d, std::uint64_t off, std::span<std::byte
   // { d.size() } -> std::same_as<std::uint64_t>;
 };
 
+// Устройство, у которого read_at константный и потокобезопасный: его можно вызывать одновременно из нескольких
+// потоков (pread, mmap). FileDevice сюда не входит - он двигает общую позицию потока.
+template<class Dev>
+concept ConcurrentReadableDevice = ReadableDevice<Dev> && requires(const Dev& d, std::uint64_t off, std::span<std::byte> dst) {
+  { d.read_at(off, dst) } -> std::same_as<bool>;
+};
+
+// Устройство, которое может отдать байты без копирования (например, из отображённого в память файла).
+// view_at возвращает пустой span, если диапазон недоступен целиком.
+template<class Dev>
+concept ViewableDevice = ReadableDevice<Dev> && requires(Dev& d, std::uint64_t off, std::size_t size) {
+  { d.view_at(off, size) } -> std::same_as<std::span<const std::byte>>;
+};
+
+// Устройство поверх открытого файлового дескриптора: его байты можно отдавать ядру напрямую (copy_file_range, sendfile)
+template<class Dev>
+concept FileDescriptorDevice = ReadableDevice<Dev> && requires(const Dev& d) {
+  { d.native_handle() } -> std::same_as<int>;
+};
+
+// Одно чтение из пачки: offset байт устройства -> dst
+struct ReadRequest {
+  std::uint64_t offset;
+  std::span<std::byte> dst;
+};
+
+// Устройство, которое умеет выполнить пачку чтений само (preadv, одно склеенное чтение и т.п.)
+template<class Dev>
+concept BatchReadableDevice = ReadableDevice<Dev> && requires(Dev& d, std::span<const ReadRequest> requests) {
+  { d.read_many(requests) } -> std::same_as<bool>;
+};
+
+/**
+ * Выполняет пачку чтений. Если устройство не умеет read_many, запросы идут циклом через read_at,
+ * причём соседние запросы, непрерывные и на устройстве, и в памяти, склеиваются в одно чтение.
+ */
+template<ReadableDevice Dev>
+bool read_many(Dev& dev, std::span<const ReadRequest> requests) {
+  if constexpr (BatchReadableDevice<Dev>) {
+    return dev.read_many(requests);
+  } else {
+    while (not requests.empty()) {
+      auto [offset, dst] = requests.front();
+      std::size_t merged = 1;
+      for (; merged < requests.size(); ++merged) {
+        const auto& next = requests[merged];
+        if (next.offset != offset + dst.size() || next.dst.data() != dst.data() + dst.size()) {
+          break;
+        }
+        dst = {dst.data(), dst.size() + next.dst.size()};
+      }
+
+      if (not dev.read_at(offset, dst)) {
+        return false;
+      }
+      requests = requests.subspan(merged);
+    }
+    return true;
+  }
+}
+
+// Устройство, которому можно заранее подсказать, какие байты скоро понадобятся (posix_fadvise, madvise).
+// prefetch только подсказка: он не ждёт чтения и ничего не возвращает.
+template<class Dev>
+concept PrefetchableDevice = ReadableDevice<Dev> && requires(Dev& d, std::uint64_t off, std::uint64_t size) {
+  d.prefetch(off, size);
+};
+
+// Подсказывает устройству все диапазоны пачки; для устройств без prefetch ничего не делает
+template<ReadableDevice Dev>
+void prefetch(Dev& dev, std::span<const ReadRequest> requests) {
+  if constexpr (PrefetchableDevice<Dev>) {
+    for (const auto& [offset, dst] : requests) {
+      dev.prefetch(offset, dst.size());
+    }
+  }
+}
+
+// Обработчик завершения пачки асинхронных чтений: true, если все запросы прочитаны целиком
+using ReadCompletion = std::move_only_function<void(bool)>;
+
+/**
+ * Устройство с асинхронной пачкой чтений: read_many_async ставит все запросы в очередь сразу и возвращается,
+ * done вызывается ровно один раз (возможно, из другого потока), когда завершится последний из них.
+ * Буферы dst должны жить до вызова done, сам список запросов устройство копирует.
+ */
+template<class Dev>
+concept AsyncReadableDevice = ReadableDevice<Dev> && requires(Dev& d, std::span<const ReadRequest> requests,
+                                                              ReadCompletion done) {
+  d.read_many_async(requests, std::move(done));
+};
+
+// Асинхронная пачка чтений; устройства без поддержки выполняют её синхронно и сразу вызывают done
+template<ReadableDevice Dev>
+void read_many_async(Dev& dev, std::span<const ReadRequest> requests, ReadCompletion done) {
+  if constexpr (AsyncReadableDevice<Dev>) {
+    dev.read_many_async(requests, std::move(done));
+  } else {
+    done(read_many(dev, requests));
+  }
+}
+
 template<class Dev>
 concept WritableDevice = ReadableDevice<Dev> && requires(Dev& d, std::uint64_t off, std::span<const std::byte> src) {
   { d.write_at(off, src) } -> std::same_as<bool>;
@@ -31,9 +135,17 @@ concept MountableDevice = ReadableDevice<Dev> && requires(Dev& dev) {
 template<typename T>
 concept PathConvertible = std::convertible_to<T, std::filesystem::path>;
 
+// Обработчик завершения асинхронного чтения файла: содержимое файла, пустое при ошибке
+using ReadFileCompletion = std::move_only_function<void(std::vector<std::byte>)>;
+
 template<class D>
-concept FileSystemDriver = requires(D d, std::filesystem::path p) {
+concept FileSystemDriver = requires(D d, std::filesystem::path p, std::uint64_t offset, std::span<std::byte> dst,
+                                    std::pmr::memory_resource* resource) {
   { d.read_file(p) } -> std::same_as<std::vector<std::byte>>;
+  { d.read_file(p, resource) } -> std::same_as<std::pmr::vector<std::byte>>;
+  // Число прочитанных байт или ошибка драйвера
+  { d.read_into(p, dst) } -> std::same_as<std::expected<std::size_t, typename D::error_type>>;
+  { d.read_range(p, offset, dst) } -> std::same_as<std::expected<std::size_t, typename D::error_type>>;
   // { d.exists(p) }    -> std::same_as<bool>;
   { d.file_size(p) } -> std::same_as<int>;
   { d.is_directory(p) } -> std::same_as<bool>;
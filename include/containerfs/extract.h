@@ -0,0 +1,293 @@
+#pragma once
+
+#include "device_api.h"
+#include "namespace.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+CONTAINERFS_NAMESPACE_BEGIN
+
+// Итог извлечения: сколько создано файлов и каталогов, сколько байт записано и за какое время
+struct ExtractStats {
+  std::uint64_t files = 0;
+  std::uint64_t directories = 0;
+  std::uint64_t bytes = 0;
+  std::chrono::duration<double> elapsed{};
+
+  [[nodiscard]] double bytes_per_second() const noexcept {
+    return elapsed.count() > 0 ? static_cast<double>(bytes) / elapsed.count() : 0;
+  }
+};
+
+/**
+ * Что извлечь: каталоги, файлы и куски файлов. Драйвер строит план по своим метаданным, extract() его выполняет.
+ * Кусок - size байт файла file начиная с file_offset: с устройства по offset или, если memory не nullptr,
+ * из памяти драйвера (например, из мини-потока OLE), которая должна жить до конца extract().
+ */
+struct ExtractPlan {
+  struct File {
+    std::filesystem::path path;
+    std::uint64_t size = 0;
+  };
+
+  struct Piece {
+    std::uint64_t offset = 0;
+    std::uint64_t file_offset = 0;
+    std::uint64_t size = 0;
+    std::uint32_t file = 0;
+    const std::byte* memory = nullptr;
+  };
+
+  std::vector<std::filesystem::path> directories;
+  std::vector<File> files;
+  std::vector<Piece> pieces;
+};
+
+// Размер одного буфера чтения extract()
+constexpr std::size_t kExtractBufferSize = std::size_t{4} << 20;
+
+namespace detail {
+
+// Общее состояние extract(): файлы, свободные буферы и счётчик незавершённых задач
+class Extractor {
+public:
+  // Кусок файла внутри буфера чтения
+  struct Chunk {
+    std::uint32_t file;
+    std::uint64_t file_offset;
+    std::size_t at;
+    std::size_t size;
+  };
+
+  Extractor(const ExtractPlan& plan, std::size_t buffers, std::size_t buffer_size)
+      : plan_{plan}, files_{std::make_unique<File[]>(plan.files.size())} {
+    for (std::size_t i = 0; i < plan.files.size(); ++i) {
+      files_[i].remaining.store(plan.files[i].size, std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < buffers; ++i) {
+      free_.push_back(std::make_unique_for_overwrite<std::byte[]>(buffer_size));
+    }
+  }
+
+  Extractor(const Extractor&) = delete;
+  Extractor& operator=(const Extractor&) = delete;
+
+  // Файлы, которые не дописаны из-за ошибки, закрываются здесь
+  ~Extractor() {
+    for (std::size_t i = 0; i < plan_.files.size(); ++i) {
+      if (files_[i].fd >= 0) {
+        ::close(files_[i].fd);
+      }
+    }
+  }
+
+  /**
+   * Пишет src в файл file с позиции file_offset. Файл открывается первой записью в него, а запись, после которой
+   * не осталось недописанных байт, его закрывает: открыты только файлы, в которые ещё пишут.
+   */
+  void write(std::uint32_t file, std::uint64_t file_offset, std::span<const std::byte> src) {
+    auto& f = files_[file];
+    std::call_once(f.once, [&] {
+      f.fd = ::open(plan_.files[file].path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    });
+    if (f.fd < 0 || not pwrite_all(f.fd, file_offset, src)) {
+      fail();
+      return;
+    }
+    // остальные записи в файл уже завершились: их байты вычтены раньше
+    if (f.remaining.fetch_sub(src.size(), std::memory_order_acq_rel) == src.size()) {
+      ::close(std::exchange(f.fd, -1));
+    }
+  }
+
+  // Задача на executor, которую дождётся wait()
+  template <Executor E, typename F>
+  void submit(E& executor, F task) {
+    {
+      std::lock_guard lock{mutex_};
+      ++pending_;
+    }
+    executor.submit([this, task = std::move(task)]() mutable {
+      task();
+      std::lock_guard lock{mutex_};
+      if (--pending_ == 0) {
+        cv_.notify_all();
+      }
+    });
+  }
+
+  void wait() {
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this] { return pending_ == 0; });
+  }
+
+  // Свободный буфер чтения; если все заняты, ждёт, пока задача записи вернёт свой
+  std::unique_ptr<std::byte[]> acquire() {
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this] { return not free_.empty(); });
+    auto buffer = std::move(free_.back());
+    free_.pop_back();
+    return buffer;
+  }
+
+  void release(std::unique_ptr<std::byte[]> buffer) {
+    std::lock_guard lock{mutex_};
+    free_.push_back(std::move(buffer));
+    cv_.notify_all();
+  }
+
+  void fail() noexcept { failed_.store(true, std::memory_order_relaxed); }
+  [[nodiscard]] bool failed() const noexcept { return failed_.load(std::memory_order_relaxed); }
+
+private:
+  struct File {
+    std::once_flag once;
+    int fd = -1;
+    std::atomic<std::uint64_t> remaining = 0;
+  };
+
+  static bool pwrite_all(int fd, std::uint64_t off, std::span<const std::byte> src) noexcept {
+    while (not src.empty()) {
+      const auto n = ::pwrite(fd, src.data(), src.size(), static_cast<off_t>(off));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      src = src.subspan(static_cast<std::size_t>(n));
+      off += static_cast<std::uint64_t>(n);
+    }
+    return true;
+  }
+
+  const ExtractPlan& plan_;
+  std::unique_ptr<File[]> files_;
+  std::atomic<bool> failed_ = false;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::unique_ptr<std::byte[]>> free_;
+  std::size_t pending_ = 0;
+};
+
+} // namespace detail
+
+/**
+ * Выполняет план извлечения: создаёт каталоги, затем читает куски с устройства в порядке их смещений на нём,
+ * по одной пачке read_many на буфер, и отдаёт заполненный буфер на запись задачам executor.
+ * Буферов на один больше, чем потоков у executor, и они переиспользуются: пока задачи пишут, вызывающий поток
+ * читает следующий. Куски из памяти пишутся задачами сразу, без копирования.
+ *
+ * Устройство читает только вызывающий поток, поэтому подходит любое. Вызывать extract() из задачи того же пула
+ * нельзя: поток ждёт буферы, которые возвращают задачи пула. false при первой ошибке чтения или записи,
+ * уже созданные файлы остаются.
+ */
+template <ReadableDevice Dev, Executor E>
+bool extract(Dev& dev, const ExtractPlan& plan, E& executor, ExtractStats& stats,
+             std::size_t buffer_size = kExtractBufferSize) {
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& directory : plan.directories) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+      return false;
+    }
+  }
+
+  std::size_t workers = 0;
+  if constexpr (requires { executor.size(); }) {
+    workers = executor.size();
+  }
+  detail::Extractor state{plan, workers + 1, buffer_size};
+
+  // пустые файлы только создаются
+  for (std::uint32_t file = 0; file < plan.files.size(); ++file) {
+    if (plan.files[file].size == 0) {
+      state.write(file, 0, {});
+    }
+  }
+
+  std::vector<const ExtractPlan::Piece*> memory;
+  std::vector<const ExtractPlan::Piece*> device;
+  for (const auto& piece : plan.pieces) {
+    (piece.memory != nullptr ? memory : device).push_back(std::addressof(piece));
+  }
+
+  // куски из памяти - группами примерно по буферу на задачу
+  for (std::size_t i = 0; i < memory.size();) {
+    auto j = i;
+    for (std::uint64_t bytes = 0; j < memory.size() && bytes < buffer_size; ++j) {
+      bytes += memory[j]->size;
+    }
+    state.submit(executor, [&state, group = std::span{memory}.subspan(i, j - i)] {
+      for (const auto* piece : group) {
+        state.write(piece->file, piece->file_offset, {piece->memory, static_cast<std::size_t>(piece->size)});
+      }
+    });
+    i = j;
+  }
+
+  // куски с устройства - в порядке смещений, чтобы чтение шло последовательно
+  std::ranges::sort(device, {}, &ExtractPlan::Piece::offset);
+  std::size_t next = 0;
+  std::uint64_t consumed = 0; // сколько байт device[next] уже в прошлых буферах
+  std::vector<ReadRequest> requests;
+  while (next < device.size() && not state.failed()) {
+    auto buffer = state.acquire();
+    std::vector<detail::Extractor::Chunk> chunks;
+    requests.clear();
+    for (std::size_t used = 0; next < device.size() && used < buffer_size;) {
+      const auto& piece = *device[next];
+      const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(piece.size - consumed, buffer_size - used));
+      requests.push_back({piece.offset + consumed, {buffer.get() + used, size}});
+      chunks.push_back({piece.file, piece.file_offset + consumed, used, size});
+      used += size;
+      consumed += size;
+      if (consumed == piece.size) {
+        ++next;
+        consumed = 0;
+      }
+    }
+
+    if (not read_many(dev, requests)) {
+      state.fail();
+      state.release(std::move(buffer));
+      break;
+    }
+    state.submit(executor, [&state, buffer = std::move(buffer), chunks = std::move(chunks)]() mutable {
+      for (const auto& [file, file_offset, at, size] : chunks) {
+        state.write(file, file_offset, {buffer.get() + at, size});
+      }
+      state.release(std::move(buffer));
+    });
+  }
+  state.wait();
+
+  stats.directories = plan.directories.size();
+  stats.files = plan.files.size();
+  stats.bytes = 0;
+  for (const auto& file : plan.files) {
+    stats.bytes += file.size;
+  }
+  stats.elapsed = std::chrono::steady_clock::now() - start;
+  return not state.failed();
+}
+
+CONTAINERFS_NAMESPACE_END
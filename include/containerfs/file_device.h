@@ -1,5 +1,6 @@
 #pragma once
 
+#include "device_api.h"
 #include "namespace.h"
 
 #include <filesystem>
@@ -13,6 +14,8 @@ public:
   explicit FileDevice(const std::filesystem::path& path): dev_{std::make_unique<std::ifstream>(path, std::ios::binary | std::ios::in)} {}
 
   bool read_at(std::uint64_t off, std::span<std::byte> dst) {
+    // неудачное чтение (например, за концом файла) не должно ломать следующие
+    dev_->clear();
     if (not dev_->seekg(static_cast<int64_t>(off), std::ios::beg)) {
       return false;
     }
@@ -23,6 +26,26 @@ public:
 
     return true;
   }
+
+  // Подряд идущие на устройстве запросы читаются одним проходом потока, без seekg между ними
+  bool read_many(std::span<const ReadRequest> requests) {
+    std::uint64_t pos = 0;
+    bool positioned = false;
+    dev_->clear();
+    for (const auto& [offset, dst] : requests) {
+      if ((not positioned || offset != pos) && not dev_->seekg(static_cast<int64_t>(offset), std::ios::beg)) {
+        return false;
+      }
+
+      if (not dev_->read(reinterpret_cast<char*>(dst.data()), static_cast<std::streamsize>(dst.size()))) {
+        return false;
+      }
+
+      pos = offset + dst.size();
+      positioned = true;
+    }
+    return true;
+  }
 private:
   std::unique_ptr<std::istream> dev_;
 };
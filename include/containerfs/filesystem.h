@@ -1,13 +1,28 @@
 #pragma once
 
+#include "cached_device.h"
 #include "device_api.h"
 #include "file_device.h"
+#include "io_uring_device.h"
+#include "mmap_device.h"
+#include "posix_file_device.h"
 #include "namespace.h"
 
+#include <memory_resource>
+#include <span>
 #include <vector>
 
 CONTAINERFS_NAMESPACE_BEGIN
 
+/**
+ * Смонтированный контейнер.
+ *
+ * Thread safety: после mount() метаданные не меняются, поэтому const методы (exists, file_size, is_directory)
+ * можно вызывать из любого числа потоков одновременно. read_file не хранит состояния между вызовами и трогает
+ * только устройство, поэтому для устройств с ConcurrentReadableDevice (PosixFileDevice, MmapDevice) один
+ * FileSystem можно делить между всеми потоками пула. С FileDevice чтения нужно сериализовать снаружи
+ * или монтировать контейнер в каждом потоке отдельно.
+ */
 template <FileSystemDriver Driver>
 class FileSystem final {
 public:
@@ -17,16 +32,100 @@ public:
   // Для сохранения семантики mount<OleDriver>(Device {...});
   // Так видно, что монтируется файловая система и используется такой-то драйвер
   // Простой конструктор не подходит, если мы хотим использовать std::expected в качестве основного механизма возврата ошибок
-  template<template <ReadableDevice> class DriverT, ReadableDevice Device>
-  friend auto mount(Device&& dev) -> std::expected<FileSystem<DriverT<Device>>, typename DriverT<Device>::error_type>;
+  template<template <ReadableDevice> class DriverT, ReadableDevice Device, typename... Args>
+  friend auto mount(Device&& dev, Args&&... args) -> std::expected<FileSystem<DriverT<Device>>, typename DriverT<Device>::error_type>;
 
   std::vector<std::byte> read_file(std::filesystem::path const& path) {
     return driver_.read_file(path);
   }
 
-  template<PathConvertible T>
-  bool exists(T path) const noexcept { return driver_.exists(path); }
+  // Память результата - из resource, например, из std::pmr::monotonic_buffer_resource горячего цикла
+  std::pmr::vector<std::byte> read_file(std::filesystem::path const& path, std::pmr::memory_resource* resource) {
+    return driver_.read_file(path, resource);
+  }
+
+  // Файл целиком в буфер вызывающего, без аллокаций; буфер меньше файла - ошибка
+  std::expected<std::size_t, error_type> read_into(std::filesystem::path const& path, std::span<std::byte> dst) {
+    return driver_.read_into(path, dst);
+  }
+
+  // Байты файла с offset, как pread: с устройства читается только то, что пересекает диапазон
+  std::expected<std::size_t, error_type> read_range(std::filesystem::path const& path, std::uint64_t offset,
+                                                    std::span<std::byte> dst) {
+    return driver_.read_range(path, offset, dst);
+  }
+
+  // Файл кусками, см. OleDriver::read_chunks: for (std::span<const std::byte> chunk : *fs.read_chunks(path, size))
+  template<typename... Args>
+  auto read_chunks(std::filesystem::path const& path, Args&&... args)
+    requires requires(Driver& d) { d.read_chunks(path, std::forward<Args>(args)...); }
+  {
+    return driver_.read_chunks(path, std::forward<Args>(args)...);
+  }
+
+  /**
+   * Асинхронное чтение: все чтения файла уходят в устройство сразу (см. AsyncReadableDevice), done вызывается,
+   * когда они завершатся. FileSystem должен пережить все незавершённые чтения.
+   */
+  void read_file_async(std::filesystem::path const& path, ReadFileCompletion done) {
+    driver_.read_file_async(path, std::move(done));
+  }
+
+  /**
+   * Файл контейнера как ReadableDevice (если драйвер это умеет), например, чтобы смонтировать вложенный контейнер
+   * без копии в память: mount<OleDriver>(*fs.open_stream(path)). FileSystem должен пережить устройство.
+   */
+  auto open_stream(std::filesystem::path const& path) requires requires(Driver& d) { d.open_stream(path); }
+  {
+    return driver_.open_stream(path);
+  }
+
+  /**
+   * Поток в открытый дескриптор (файл, сокет, канал) без копии в std::vector (если драйвер это умеет); для устройств
+   * с дескриптором байты копирует ядро. Возвращает число записанных байт, см. OleDriver::copy_stream_to.
+   */
+  auto copy_stream_to(std::filesystem::path const& path, int out_fd)
+    requires requires(Driver& d) { d.copy_stream_to(path, out_fd); }
+  {
+    return driver_.copy_stream_to(path, out_fd);
+  }
+
+  /**
+   * Извлечение на диск (если драйвер это умеет): extract_all(dest) - весь контейнер, extract_subtree(path, dest) -
+   * одно хранилище или поток. Дальше можно передать ThreadPool для записи и размер буфера чтения,
+   * см. OleDriver::extract_all.
+   */
+  template<typename... Args>
+  auto extract_all(std::filesystem::path const& dest, Args&&... args)
+    requires requires(Driver& d) { d.extract_all(dest, std::forward<Args>(args)...); }
+  {
+    return driver_.extract_all(dest, std::forward<Args>(args)...);
+  }
+
+  template<typename... Args>
+  auto extract_subtree(std::filesystem::path const& path, std::filesystem::path const& dest, Args&&... args)
+    requires requires(Driver& d) { d.extract_subtree(path, dest, std::forward<Args>(args)...); }
+  {
+    return driver_.extract_subtree(path, dest, std::forward<Args>(args)...);
+  }
+
+  // Обход всех записей контейнера в глубину (если драйвер это умеет), см. OleDriver::recursive_directory_view
+  auto recursive_directory_view() const requires requires(const Driver& d) { d.recursive_directory_view(); }
+  {
+    return driver_.recursive_directory_view();
+  }
+
+  // Кроме std::filesystem::path принимаются пути, которые понимает драйвер (для OLE - ole::Path и ole::PathView)
+  template<typename T> requires requires(const Driver& d, const T& p) { d.exists(p); }
+  bool exists(const T& path) const noexcept { return driver_.exists(path); }
+  bool exists(std::filesystem::path const& path) const noexcept { return driver_.exists(path); }
+
+  template<typename T> requires requires(const Driver& d, const T& p) { d.file_size(p); }
+  int file_size(const T& path) const noexcept { return driver_.file_size(path); }
   int file_size(std::filesystem::path const& path) const noexcept { return driver_.file_size(path); }
+
+  template<typename T> requires requires(const Driver& d, const T& p) { d.is_directory(p); }
+  bool is_directory(const T& path) const noexcept { return driver_.is_directory(path); }
   bool is_directory(std::filesystem::path const& path) const noexcept { return driver_.is_directory(path); }
 
 private:
@@ -34,10 +133,11 @@ private:
   Driver driver_;
 };
 
-template<template <ReadableDevice> class Driver, ReadableDevice Device>
-auto mount(Device&& dev) -> std::expected<FileSystem<Driver<Device>>, typename Driver<Device>::error_type> {
+// Параметры после устройства уходят в Driver::create, например mount<LazyOleDriver>(dev, resident_sectors)
+template<template <ReadableDevice> class Driver, ReadableDevice Device, typename... Args>
+auto mount(Device&& dev, Args&&... args) -> std::expected<FileSystem<Driver<Device>>, typename Driver<Device>::error_type> {
   using D = Driver<Device>;
-  auto expected = D::create(std::forward<Device>(dev));
+  auto expected = D::create(std::forward<Device>(dev), std::forward<Args>(args)...);
   if (!expected) {
     return std::unexpected(expected.error());
   }
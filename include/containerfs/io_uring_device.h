@@ -0,0 +1,324 @@
+#pragma once
+
+#include "device_api.h"
+#include "namespace.h"
+#include "posix_file_device.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+CONTAINERFS_NAMESPACE_BEGIN
+
+namespace detail {
+
+struct AsyncBatch;
+
+// Один запрос пачки; адрес стабилен, пока пачка жива, поэтому годится как user_data
+struct AsyncOp {
+  AsyncBatch* batch;
+  std::uint64_t offset;
+  std::span<std::byte> dst;
+  iovec iov;
+};
+
+// Пачка асинхронных чтений: done вызывается, когда завершится последний запрос
+struct AsyncBatch {
+  AsyncBatch(const PosixFileDevice* file, std::span<const ReadRequest> requests, ReadCompletion done)
+      : file{file}, pending{requests.size()}, done{std::move(done)} {
+    ops.reserve(requests.size());
+    for (const auto& [offset, dst] : requests) {
+      ops.push_back({this, offset, dst, {dst.data(), dst.size()}});
+    }
+  }
+
+  // Отмечает завершение запроса op. Последний вызов отдаёт результат в done и удаляет пачку
+  static void complete(AsyncOp& op, bool ok) {
+    auto* batch = op.batch;
+    if (not ok) {
+      batch->ok.store(false, std::memory_order_relaxed);
+    }
+    if (batch->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      auto done = std::move(batch->done);
+      const auto result = batch->ok.load(std::memory_order_relaxed);
+      delete batch;
+      done(result);
+    }
+  }
+
+  const PosixFileDevice* file;
+  std::vector<AsyncOp> ops;
+  std::atomic<std::size_t> pending;
+  std::atomic<bool> ok{true};
+  ReadCompletion done;
+};
+
+/**
+ * Минимальное кольцо io_uring поверх сырых системных вызовов (без liburing).
+ * Запросы ставятся из любого потока, завершения разбирает собственный поток кольца.
+ */
+class IoUring final {
+public:
+  // nullptr, если io_uring недоступен: старое ядро, seccomp, io_uring_disabled и т.п.
+  static std::unique_ptr<IoUring> create(unsigned entries) {
+    io_uring_params params{};
+    const auto fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+      return nullptr;
+    }
+
+    // без NODROP переполнение CQ теряет завершения, без SINGLE_MMAP нужна отдельная проекция CQ
+    if ((params.features & IORING_FEAT_NODROP) == 0 || (params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+      ::close(fd);
+      return nullptr;
+    }
+
+    const auto ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                    params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    void* ring = ::mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) {
+      ::close(fd);
+      return nullptr;
+    }
+
+    const auto sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      ::munmap(ring, ring_size);
+      ::close(fd);
+      return nullptr;
+    }
+
+    return std::unique_ptr<IoUring>(new IoUring(fd, params, ring, ring_size, static_cast<io_uring_sqe*>(sqes)));
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  // Дожидается завершения всех запросов в полёте
+  ~IoUring() {
+    {
+      std::lock_guard lock{mutex_};
+      stopping_ = true;
+      // будим поток завершений, если он спит в io_uring_enter
+      push(nullptr, IORING_OP_NOP, -1, 0);
+      flush();
+    }
+    reaper_.join();
+
+    ::munmap(sqes_, sq_entries_ * sizeof(io_uring_sqe));
+    ::munmap(ring_, ring_size_);
+    ::close(fd_);
+  }
+
+  // Ставит все ops в очередь и отправляет ядру одним io_uring_enter (или несколькими, если не влезли в SQ)
+  void submit(int file_fd, std::span<AsyncOp> ops) {
+    std::unique_lock lock{mutex_};
+    for (auto& op : ops) {
+      // не держим в полёте больше, чем помещается в CQ; перед ожиданием отдаём ядру уже поставленное
+      if (inflight_ == cq_entries_) {
+        flush();
+        space_.wait(lock, [this] { return inflight_ < cq_entries_; });
+      }
+      if (sq_full()) {
+        flush();
+      }
+      push(&op, IORING_OP_READV, file_fd, op.offset);
+      ++inflight_;
+    }
+    flush();
+  }
+
+private:
+  IoUring(int fd, const io_uring_params& params, void* ring, std::size_t ring_size, io_uring_sqe* sqes)
+      : fd_{fd}, ring_{ring}, ring_size_{ring_size}, sqes_{sqes}, sq_entries_{params.sq_entries},
+        cq_entries_{params.cq_entries} {
+    auto* base = static_cast<std::byte*>(ring);
+    sq_head_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+    reaper_ = std::jthread([this] { reap(); });
+  }
+
+  [[nodiscard]] bool sq_full() const noexcept {
+    return *sq_tail_ - std::atomic_ref{*sq_head_}.load(std::memory_order_acquire) == sq_entries_;
+  }
+
+  // Вызывается под mutex_, в SQ есть место
+  void push(AsyncOp* op, std::uint8_t opcode, int file_fd, std::uint64_t offset) noexcept {
+    const auto tail = *sq_tail_;
+    const auto index = tail & sq_mask_;
+    auto& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = file_fd;
+    sqe.off = offset;
+    if (op != nullptr) {
+      sqe.addr = reinterpret_cast<std::uint64_t>(&op->iov);
+      sqe.len = 1;
+    }
+    sqe.user_data = reinterpret_cast<std::uint64_t>(op);
+    sq_array_[index] = index;
+    std::atomic_ref{*sq_tail_}.store(tail + 1, std::memory_order_release);
+    ++unsubmitted_;
+  }
+
+  // Вызывается под mutex_: отдаёт ядру всё, что накопилось в SQ
+  void flush() noexcept {
+    while (unsubmitted_ != 0) {
+      const auto n = ::syscall(__NR_io_uring_enter, fd_, unsubmitted_, 0, 0, nullptr, 0);
+      if (n < 0) {
+        // EINTR, EAGAIN, EBUSY: ядро временно не может принять запросы, повторяем
+        std::this_thread::yield();
+        continue;
+      }
+      unsubmitted_ -= static_cast<unsigned>(n);
+    }
+  }
+
+  void reap() {
+    for (;;) {
+      auto head = *cq_head_;
+      const auto tail = std::atomic_ref{*cq_tail_}.load(std::memory_order_acquire);
+      if (head == tail) {
+        {
+          std::lock_guard lock{mutex_};
+          if (stopping_ && inflight_ == 0) {
+            return;
+          }
+        }
+        // ждём хотя бы одно завершение
+        ::syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        continue;
+      }
+
+      // Передача запроса через ядро не видна модели памяти C++: захват mutex_, под которым запросы
+      // ставились в SQ, делает записи в AsyncOp/AsyncBatch видимыми этому потоку
+      { std::lock_guard lock{mutex_}; }
+
+      std::size_t completed = 0;
+      for (; head != tail; ++head) {
+        const auto cqe = cqes_[head & cq_mask_];
+        auto* op = reinterpret_cast<AsyncOp*>(cqe.user_data);
+        if (op == nullptr) {
+          continue;
+        }
+
+        ++completed;
+        if (cqe.res < 0) {
+          AsyncBatch::complete(*op, false);
+        } else if (const auto done = static_cast<std::size_t>(cqe.res); done < op->dst.size()) {
+          // короткое чтение: дочитываем хвост синхронно
+          AsyncBatch::complete(*op, op->batch->file->read_at(op->offset + done, op->dst.subspan(done)));
+        } else {
+          AsyncBatch::complete(*op, true);
+        }
+      }
+      std::atomic_ref{*cq_head_}.store(head, std::memory_order_release);
+
+      {
+        std::lock_guard lock{mutex_};
+        inflight_ -= completed;
+      }
+      space_.notify_all();
+    }
+  }
+
+  int fd_;
+  void* ring_;
+  std::size_t ring_size_;
+  io_uring_sqe* sqes_;
+  unsigned sq_entries_;
+  unsigned cq_entries_;
+
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe* cqes_;
+
+  std::mutex mutex_;
+  std::condition_variable space_;
+  unsigned unsubmitted_ = 0;
+  std::size_t inflight_ = 0;
+  bool stopping_ = false;
+  std::jthread reaper_;
+};
+
+} // namespace detail
+
+/**
+ * Устройство для большой глубины очереди: read_many_async ставит всю пачку в io_uring разом, без io_uring - в пул
+ * потоков с pread. Обработчики завершений идут в потоках кольца (пула) - они должны быть короткими и не разрушать
+ * устройство; деструктор дожидается всех чтений. Синхронные read_at/read_many - это pread, их можно звать из любых потоков.
+ */
+class IoUringDevice final {
+public:
+  explicit IoUringDevice(const std::filesystem::path& path, unsigned queue_depth = 256)
+      : file_{std::make_unique<PosixFileDevice>(path)}, ring_{detail::IoUring::create(queue_depth)} {
+    if (ring_ == nullptr) {
+      pool_ = std::make_unique<ThreadPool>();
+    }
+  }
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) const noexcept { return file_->read_at(off, dst); }
+
+  bool read_many(std::span<const ReadRequest> requests) const noexcept { return file_->read_many(requests); }
+
+  void read_many_async(std::span<const ReadRequest> requests, ReadCompletion done) const {
+    if (requests.empty()) {
+      done(true);
+      return;
+    }
+
+    // пачка удаляет себя сама после последнего завершения, после постановки её трогать нельзя
+    auto* batch = new detail::AsyncBatch(file_.get(), requests, std::move(done));
+    const std::span ops{batch->ops};
+    if (ring_ != nullptr) {
+      ring_->submit(file_->native_handle(), ops);
+      return;
+    }
+
+    for (auto& op : ops) {
+      pool_->submit([&op] { detail::AsyncBatch::complete(op, op.batch->file->read_at(op.offset, op.dst)); });
+    }
+  }
+
+  // false, если асинхронные чтения идут через пул потоков
+  [[nodiscard]] bool uses_io_uring() const noexcept { return ring_ != nullptr; }
+
+  void prefetch(std::uint64_t off, std::uint64_t size) const noexcept { file_->prefetch(off, size); }
+
+  [[nodiscard]] std::uint64_t size() const noexcept { return file_->size(); }
+
+  [[nodiscard]] int native_handle() const noexcept { return file_->native_handle(); }
+
+private:
+  // Порядок важен: кольцо и пул дожидаются своих чтений раньше, чем закроется файл
+  std::unique_ptr<PosixFileDevice> file_;
+  std::unique_ptr<detail::IoUring> ring_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+CONTAINERFS_NAMESPACE_END
\ No newline at end of file
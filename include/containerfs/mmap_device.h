@@ -0,0 +1,107 @@
+#pragma once
+
+#include "namespace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CONTAINERFS_NAMESPACE_BEGIN
+
+/**
+ * Устройство поверх отображённого в память файла, только чтение.
+ *
+ * read_at - memcpy из отображения, view_at отдаёт span прямо в него, так что сектора разбираются на месте.
+ * span живёт, пока живо устройство (или драйвер, в который его переместили). Если файл не открылся или
+ * не отобразился, устройство пустое и любое чтение неудачно.
+ */
+class MmapDevice final {
+public:
+  explicit MmapDevice(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      if (void* addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+          addr != MAP_FAILED) {
+        data_ = static_cast<const std::byte*>(addr);
+        size_ = static_cast<std::uint64_t>(st.st_size);
+      }
+    }
+
+    // отображение не зависит от дескриптора
+    ::close(fd);
+  }
+
+  MmapDevice(const MmapDevice&) = delete;
+  MmapDevice& operator=(const MmapDevice&) = delete;
+
+  MmapDevice(MmapDevice&& other) noexcept
+      : data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)} {}
+
+  MmapDevice& operator=(MmapDevice&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  ~MmapDevice() { unmap(); }
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) const noexcept {
+    const auto src = view_at(off, dst.size());
+    if (src.size() != dst.size()) {
+      return false;
+    }
+
+    if (not src.empty()) {
+      std::memcpy(dst.data(), src.data(), src.size());
+    }
+    return true;
+  }
+
+  // Пустой span, если запрошенный диапазон не помещается в файл
+  [[nodiscard]] std::span<const std::byte> view_at(std::uint64_t off, std::size_t size) const noexcept {
+    if (off > size_ || size > size_ - off) {
+      return {};
+    }
+    return {data_ + off, size};
+  }
+
+  // madvise(WILLNEED) по страницам диапазона: ядро начинает подкачку до первого обращения
+  void prefetch(std::uint64_t off, std::uint64_t size) const noexcept {
+    if (off >= size_) {
+      return;
+    }
+    const auto page = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    const auto first = off / page * page;
+    const auto last = std::min(off + size, size_);
+    ::madvise(const_cast<std::byte*>(data_) + first, static_cast<std::size_t>(last - first), MADV_WILLNEED);
+  }
+
+  [[nodiscard]] std::uint64_t size() const noexcept { return size_; }
+
+private:
+  void unmap() noexcept {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<std::byte*>(data_), static_cast<std::size_t>(size_));
+    }
+  }
+
+  const std::byte* data_ = nullptr;
+  std::uint64_t size_ = 0;
+};
+
+CONTAINERFS_NAMESPACE_END
\ No newline at end of file
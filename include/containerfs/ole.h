@@ -1,18 +1,38 @@
 #pragma once
 
+#include "containerfs/descriptor_sink.h"
 #include "containerfs/device_api.h"
+#include "containerfs/extract.h"
+#include "containerfs/thread_pool.h"
 #include "ole_directory.h"
 #include "ole_error.h"
 #include "ole_path.h"
+#include "ole_path_index.h"
 #include "ole_string.h"
 
 #include <algorithm>
+#include <atomic>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <condition_variable>
 #include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <ranges>
 #include <stack>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 constexpr std::uint32_t FREESECT = 0xFFFFFFFF;
 constexpr std::uint32_t ENDOFCHAIN = 0xFFFFFFFE;
@@ -21,7 +41,7 @@ constexpr std::uint32_t DIFSECT = 0xFFFFFFFC;
 
 using fat_t = std::uint32_t;
 
-// POD заголовок (минимально нужные поля)
+// Заголовок в том виде, в каком он лежит в файле: поля идут подряд без выравнивающих дыр, 512 байт little-endian
 struct OleHeader {
   std::array<std::byte, 8> magic{};
   std::array<std::byte, 16> clsid{};
@@ -43,61 +63,243 @@ struct OleHeader {
   std::array<std::uint32_t, 109> difat{};
 };
 
-constexpr auto operator|(std::ranges::range auto &&src, std::ranges::sized_range auto &dst) {
-  auto d = std::as_writable_bytes(std::span(dst));
-  auto res = std::ranges::copy_n(src.begin(), d.size(), d.begin());
-  return std::ranges::subrange(res.in, src.end());
+static_assert(sizeof(OleHeader) == 512 && offsetof(OleHeader, num_dir_sectors) == 40 && offsetof(OleHeader, difat) == 76);
+static_assert(std::is_trivially_copyable_v<OleHeader>);
+
+// Little-endian wire-структуры ниже разбираются копированием байт как есть
+static_assert(std::endian::native == std::endian::little, "OLE wire structs are decoded on little-endian hosts only");
+
+/**
+ * Wire-структура прямо из байт буфера (bit_cast из span): один memcpy в объект, который компилятор сводит
+ * к нескольким векторным загрузкам. Выравнивание буфера не важно.
+ */
+template <typename Wire>
+Wire wire_cast(std::span<const std::byte, sizeof(Wire)> bytes) noexcept {
+  static_assert(std::is_trivially_copyable_v<Wire>);
+  Wire result;
+  std::memcpy(&result, bytes.data(), sizeof(Wire));
+  return result;
+}
+
+// Смещение сектора (SID) в байтах (OLE: заголовок = "нулевой сектор"); sector_size - 512 или 4096,
+// а у участков ExtentIndex - размер их единицы, поэтому 32 бита
+constexpr auto sector_offset (fat_t sid, std::uint32_t sector_size) -> std::uint64_t {
+  return (std::uint64_t{sid} + 1) * sector_size;
+}
+
+// Запросы на чтение секторов sids подряд в dst: сектора с идущими подряд номерами сливаются в один запрос
+inline std::vector<containerfs::ReadRequest> sector_requests(std::span<const fat_t> sids, std::uint16_t sector_size,
+                                                             std::span<std::byte> dst) {
+  std::vector<containerfs::ReadRequest> requests;
+  for (std::size_t first = 0; first < sids.size();) {
+    std::size_t run = 1;
+    while (first + run < sids.size() && sids[first + run] == sids[first] + run) {
+      ++run;
+    }
+    requests.push_back({sector_offset(sids[first], sector_size), dst.subspan(first * sector_size, run * sector_size)});
+    first += run;
+  }
+  return requests;
 }
 
-constexpr auto operator|(std::ranges::range auto &&src, std::integral auto &dst) {
-  std::span<std::byte, sizeof(dst)> d{reinterpret_cast<std::byte *>(std::addressof(dst)), sizeof(dst)};
-  return src | d;
+/**
+ * Пачка чтений по цепочке. Если цепочка разрывна, сначала все её участки подсказываются устройству
+ * (PrefetchableDevice): ядро начинает читать их все сразу, пока read_many дожидается первого.
+ */
+template <typename Device>
+bool read_with_prefetch(Device &device, std::span<const containerfs::ReadRequest> requests) {
+  if (requests.size() > 1) {
+    containerfs::prefetch(device, requests);
+  }
+  return containerfs::read_many(device, requests);
 }
 
-constexpr auto operator|(std::ranges::range auto &&src, std::byte &dst) {
-  auto res = std::ranges::copy_n(src.begin(), sizeof(dst), std::addressof(dst));
-  return std::ranges::subrange(res.in, src.end());
+// Читает сектора sids подряд в dst одной пачкой read_many
+template <typename Device>
+bool read_sectors(Device &device, std::span<const fat_t> sids, std::uint16_t sector_size, std::span<std::byte> dst) {
+  return read_with_prefetch(device, sector_requests(sids, sector_size, dst));
 }
 
-// Смещение сектора (SID) в байтах (OLE: заголовок = "нулевой сектор")
-constexpr auto sector_offset (fat_t sid, std::uint16_t sector_size) -> std::uint64_t {
-  return (sid + 1) * static_cast<std::uint64_t>(sector_size);
+// Сколько секторов читает одна задача параллельной загрузки и сколько записей каталога она разбирает
+constexpr std::size_t kSectorsPerTask = 64;
+constexpr std::size_t kEntriesPerTask = 1024;
+
+// Делит [0, count) на куски по grain и вызывает f(first, last) для каждого на потоках executor
+template <containerfs::Executor E, typename F>
+void for_each_chunk(E &executor, std::size_t count, std::size_t grain, F f) {
+  containerfs::parallel_for(executor, (count + grain - 1) / grain, [&](std::size_t chunk) {
+    const auto first = chunk * grain;
+    f(first, std::min(count, first + grain));
+  });
 }
 
+/**
+ * read_sectors на потоках executor: сектора делятся на пачки по kSectorsPerTask, каждая читается сразу в свой
+ * участок dst. Параллельно читаются только ConcurrentReadableDevice (и только через константный интерфейс),
+ * для остальных устройств и InlineExecutor это одна пачка read_sectors.
+ */
+template <typename Device, containerfs::Executor E>
+bool read_sectors(Device &device, std::span<const fat_t> sids, std::uint16_t sector_size, std::span<std::byte> dst,
+                  E &executor) {
+  if constexpr (containerfs::ConcurrentReadableDevice<Device> &&
+                not std::same_as<std::remove_cvref_t<E>, containerfs::InlineExecutor>) {
+    if (sids.size() > kSectorsPerTask) {
+      std::atomic<bool> ok = true;
+      for_each_chunk(executor, sids.size(), kSectorsPerTask, [&](std::size_t first, std::size_t last) {
+        const auto part = sids.subspan(first, last - first);
+        if (not read_sectors(std::as_const(device), part, sector_size, dst.subspan(first * sector_size, part.size() * sector_size))) {
+          ok.store(false, std::memory_order_relaxed);
+        }
+      });
+      return ok.load(std::memory_order_relaxed);
+    }
+  }
+  return read_sectors(device, sids, sector_size, dst);
+}
+
+/**
+ * Номера секторов цепочки, начиная с first, по уже загруженному FAT. expected - подсказка для reserve.
+ * Сектор за пределами FAT или цепочка длиннее самого FAT (цикл, если FAT не проверялся) - CorruptedFile.
+ */
+inline std::expected<std::pmr::vector<fat_t>, ole::Error> sector_chain(
+    std::span<const fat_t> fat, fat_t first, std::size_t expected = 0,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+  std::pmr::vector<fat_t> chain{resource};
+  chain.reserve(std::min(expected, fat.size()));
+  for (auto next_sector = first; next_sector != ENDOFCHAIN; next_sector = fat[next_sector]) {
+    if (next_sector >= fat.size() || chain.size() == fat.size()) [[unlikely]] {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    chain.push_back(next_sector);
+  }
+  return chain;
+}
+
+// Непрерывный участок цепочки: count секторов подряд, начиная с first
+struct Extent {
+  fat_t first;
+  std::uint32_t count;
+};
+
+// Цепочка FAT (или miniFAT) сразу в виде непрерывных участков, без списка отдельных секторов; проверки как в sector_chain
+inline std::expected<std::vector<Extent>, ole::Error> chain_extents(std::span<const fat_t> fat, fat_t first) {
+  std::vector<Extent> extents;
+  std::size_t length = 0;
+  for (auto next_sector = first; next_sector != ENDOFCHAIN; next_sector = fat[next_sector]) {
+    if (next_sector >= fat.size() || length++ == fat.size()) [[unlikely]] {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    if (not extents.empty() && extents.back().first + extents.back().count == next_sector) {
+      ++extents.back().count;
+    } else {
+      extents.push_back({next_sector, 1});
+    }
+  }
+  return extents;
+}
+
+// Сколько всего секторов в участках
+inline std::uint64_t sector_count(std::span<const Extent> extents) noexcept {
+  std::uint64_t count = 0;
+  for (const auto &extent : extents) {
+    count += extent.count;
+  }
+  return count;
+}
+
+/**
+ * Индекс участков потока: для каждого участка хранится его логическое смещение в потоке,
+ * поэтому сектор по смещению ищется двоичным поиском, а не проходом по цепочке FAT с начала.
+ * unit_size - размер сектора цепочки (обычный сектор или мини-сектор).
+ */
+class ExtentIndex {
+public:
+  struct Entry {
+    std::uint64_t offset; // логическое смещение первого байта участка в потоке
+    fat_t first;
+    std::uint32_t count;
+  };
+
+  ExtentIndex() = default;
+
+  ExtentIndex(std::span<const Extent> extents, std::uint32_t unit_size): unit_size_{unit_size} {
+    entries_.reserve(extents.size());
+    for (const auto &[first, count] : extents) {
+      entries_.push_back({size_, first, count});
+      size_ += std::uint64_t{count} * unit_size;
+    }
+  }
+
+  // Сколько байт покрывают все участки
+  [[nodiscard]] std::uint64_t size() const noexcept { return size_; }
+  [[nodiscard]] std::span<const Entry> entries() const noexcept { return entries_; }
+  [[nodiscard]] std::uint32_t unit_size() const noexcept { return unit_size_; }
+
+  // Участок, в котором лежит байт pos потока, или entries().end()
+  [[nodiscard]] std::span<const Entry>::iterator locate(std::uint64_t pos) const noexcept {
+    const auto all = entries();
+    if (pos >= size_) {
+      return all.end();
+    }
+    return std::prev(std::ranges::upper_bound(all, pos, {}, &Entry::offset));
+  }
+
+  /**
+   * Добавляет в requests чтения байт [pos, pos + dst.size()) потока прямо в dst: по одному запросу на участок.
+   * Только для цепочек обычных секторов: смещение на устройстве считается через sector_offset.
+   * Запрос, продолжающий предыдущий и на устройстве, и в памяти, склеивается с ним.
+   * Первый участок ищется двоичным поиском. false, если поток короче запрошенного.
+   */
+  bool append_requests(std::uint64_t pos, std::span<std::byte> dst,
+                       std::vector<containerfs::ReadRequest> &requests) const {
+    if (dst.empty()) {
+      return true;
+    }
+    if (dst.size() > size_ || pos > size_ - dst.size()) {
+      return false;
+    }
+
+    for (auto it = locate(pos); not dst.empty(); ++it) {
+      const auto skip = pos - it->offset;
+      const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(std::uint64_t{it->count} * unit_size_ - skip, dst.size()));
+      const auto offset = sector_offset(it->first, unit_size_) + skip;
+      if (auto *last = requests.empty() ? nullptr : &requests.back();
+          last != nullptr && last->offset + last->dst.size() == offset && last->dst.data() + last->dst.size() == dst.data()) {
+        last->dst = {last->dst.data(), last->dst.size() + size};
+      } else {
+        requests.push_back({offset, dst.first(size)});
+      }
+
+      dst = dst.subspan(size);
+      pos += size;
+    }
+    return true;
+  }
+
+private:
+  std::vector<Entry> entries_;
+  std::uint64_t size_ = 0;
+  std::uint32_t unit_size_ = 0;
+};
+
 template <typename Device, bool Validate = true>
 std::expected<OleHeader, ole::Error> load_header(Device &device) {
   /** header всегда 512 байт:
    * For version 4 compound files, the header size (512 bytes) is less than the sector size (4,096 bytes),
    * so the remaining part of the header (3,584 bytes) MUST be filled with all zeroes.
    */
-  static_assert(sizeof(OleHeader) == 512);
   std::array<std::byte, sizeof(OleHeader)> buffer{};
-  if (!device.read_at(0, buffer)) {
+  std::span<const std::byte> bytes = buffer;
+  if constexpr (containerfs::ViewableDevice<Device>) {
+    // разбираем заголовок прямо в отображении устройства
+    bytes = device.view_at(0, sizeof(OleHeader));
+    if (bytes.size() != sizeof(OleHeader)) {
+      return std::unexpected(ole::Error::IoFailure);
+    }
+  } else if (!device.read_at(0, buffer)) {
     return std::unexpected(ole::Error::IoFailure);
   }
-  // TODO bitcast to wire type
-  OleHeader hdr{};
-  [[ maybe_unused ]] const auto tail = buffer
-  | hdr.magic
-  | hdr.clsid
-  | hdr.minor_version
-  | hdr.major_version
-  | hdr.byte_order
-  | hdr.sector_shift
-  | hdr.mini_sector_shift
-  | hdr.reserved
-  | hdr.num_dir_sectors
-  | hdr.num_fat_sectors
-  | hdr.first_dir_sector
-  | hdr.transaction_signature
-  | hdr.mini_stream_cutoff_size
-  | hdr.first_mini_fat_sector
-  | hdr.num_mini_fat_sectors
-  | hdr.first_difat_sector
-  | hdr.num_difat_sectors
-  | hdr.difat;
-
-  assert(empty(tail));
+  const auto hdr = wire_cast<OleHeader>(bytes.first<sizeof(OleHeader)>());
 
   if constexpr (Validate) {
     /**
@@ -201,13 +403,140 @@ inline bool is_reserved_sid(std::uint32_t sid) noexcept {
   return sid == FREESECT || sid == ENDOFCHAIN || sid == FATSECT || sid == DIFSECT;
 }
 
-template <typename Device, bool Validate = true>
-std::expected<std::vector<fat_t>, ole::Error> load_fat(Device &device, const OleHeader &header) {
+// Самый большой номер обычного сектора (MAXREGSECT); 0xFFFFFFFB зарезервирован, дальше - DIFSECT..FREESECT
+constexpr std::uint32_t MAXREGSECT = 0xFFFFFFFA;
+
+/**
+ * Есть ли в fat запись, которая не ссылается на сектор из [0, count) и не равна DIFSECT, FATSECT, ENDOFCHAIN
+ * или FREESECT. Без ветвлений по 8 (AVX2) или 4 (SSE2) записи за раз: в SSE/AVX нет беззнакового сравнения
+ * 32-битных чисел, поэтому у обеих сторон инвертируется старший бит и сравнение идёт знаковое.
+ */
+inline bool fat_has_out_of_range(std::span<const fat_t> fat, std::uint32_t count) noexcept {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  const auto bias = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+  const auto limit = _mm256_set1_epi32(static_cast<int>(count ^ 0x80000000u));
+  const auto last_regular = _mm256_set1_epi32(static_cast<int>((DIFSECT - 1) ^ 0x80000000u));
+  auto bad = _mm256_setzero_si256();
+  for (; i + 8 <= fat.size(); i += 8) {
+    const auto v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(fat.data() + i)), bias);
+    // в диапазоне: v < count, зарезервировано: v > DIFSECT - 1; плохо - ни то, ни другое
+    const auto good = _mm256_or_si256(_mm256_cmpgt_epi32(limit, v), _mm256_cmpgt_epi32(v, last_regular));
+    bad = _mm256_or_si256(bad, _mm256_xor_si256(good, _mm256_set1_epi32(-1)));
+  }
+  if (_mm256_movemask_epi8(bad) != 0) {
+    return true;
+  }
+#elif defined(__SSE2__)
+  const auto bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+  const auto limit = _mm_set1_epi32(static_cast<int>(count ^ 0x80000000u));
+  const auto last_regular = _mm_set1_epi32(static_cast<int>((DIFSECT - 1) ^ 0x80000000u));
+  auto bad = _mm_setzero_si128();
+  for (; i + 4 <= fat.size(); i += 4) {
+    const auto v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(fat.data() + i)), bias);
+    const auto good = _mm_or_si128(_mm_cmplt_epi32(v, limit), _mm_cmpgt_epi32(v, last_regular));
+    bad = _mm_or_si128(bad, _mm_xor_si128(good, _mm_set1_epi32(-1)));
+  }
+  if (_mm_movemask_epi8(bad) != 0) {
+    return true;
+  }
+#endif
+  for (; i < fat.size(); ++i) {
+    if (fat[i] >= count && fat[i] < DIFSECT) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Проверка FAT за O(секторов) с картой пометок по байту на сектор:
+ * - каждая запись - номер сектора внутри FAT или зарезервированное значение (fat_has_out_of_range);
+ * - сектора самого FAT помечены FATSECT, сектора DIFAT - DIFSECT;
+ * - у каждого сектора не больше одного предшественника, и ссылаться можно только на сектор цепочки
+ *   (значение - номер сектора или ENDOFCHAIN): иначе сектор принадлежит двум цепочкам;
+ * - при одном предшественнике цепочки - непересекающиеся пути и циклы. Пути проходятся от голов (сектор цепочки
+ *   без предшественника) до ENDOFCHAIN, каждый сектор ровно один раз; сектор цепочки, до которого не дошли, лежит на цикле.
+ */
+inline ole::Error validate_fat(std::span<const fat_t> fat, std::span<const fat_t> fat_sectors,
+                               std::span<const fat_t> difat_sectors,
+                               std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+  if (fat.size() > std::size_t{MAXREGSECT} + 1) {
+    return ole::Error::InvalidFatEntry;
+  }
+  const auto count = static_cast<std::uint32_t>(fat.size());
+  if (fat_has_out_of_range(fat, count)) {
+    return ole::Error::InvalidFatEntry;
+  }
+  for (const auto sid : fat_sectors) {
+    if (sid >= count || fat[sid] != FATSECT) {
+      return ole::Error::InvalidFatEntry;
+    }
+  }
+  for (const auto sid : difat_sectors) {
+    if (sid >= count || fat[sid] != DIFSECT) {
+      return ole::Error::InvalidFatEntry;
+    }
+  }
+
+  const auto in_chain = [&](fat_t sid) { return fat[sid] < count || fat[sid] == ENDOFCHAIN; };
+  constexpr std::uint8_t kHasPrevious = 1;
+  constexpr std::uint8_t kVisited = 2;
+  std::pmr::vector<std::uint8_t> marks(count, resource);
+  for (std::uint32_t sid = 0; sid < count; ++sid) {
+    if (const auto next = fat[sid]; next < count) {
+      if (marks[next] != 0 || not in_chain(next)) {
+        return ole::Error::FatCrossLinked;
+      }
+      marks[next] = kHasPrevious;
+    }
+  }
+
+  for (std::uint32_t head = 0; head < count; ++head) {
+    if (marks[head] == 0 && in_chain(head)) {
+      for (auto sid = head; sid != ENDOFCHAIN; sid = fat[sid]) {
+        marks[sid] |= kVisited;
+      }
+    }
+  }
+  for (std::uint32_t sid = 0; sid < count; ++sid) {
+    if (in_chain(sid) && (marks[sid] & kVisited) == 0) {
+      return ole::Error::FatChainCycle;
+    }
+  }
+  return ole::Error::Success;
+}
+
+/**
+ * FAT целиком. Список FAT-секторов известен после прохода по DIFAT, дальше сектора независимы:
+ * с executor они читаются параллельно, каждый прямо на своё место в fat.
+ * FAT и списки секторов берутся из resource; задачи executor из него не выделяют.
+ */
+template <typename Device, bool Validate = true, containerfs::Executor E = containerfs::InlineExecutor>
+std::expected<std::pmr::vector<fat_t>, ole::Error> load_fat(Device &device, const OleHeader &header, E &&executor = {},
+                                                            std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
   const auto sector_size = 1 << header.sector_shift;
+  const auto entries_per_sector = sector_size / sizeof(fat_t);
 
-  // Список sector ID-ов FAT-секторов (строго по csectFat)
-  std::vector<fat_t> fat_sector_ids;
-  fat_sector_ids.reserve(header.num_fat_sectors);
+  // csectFat не больше, чем описывает DIFAT (109 записей заголовка и по entries_per_sector - 1 в DIFAT-секторе),
+  // и не больше секторов устройства: иначе reserve ниже просил бы у resource гигабайты по чужому заголовку
+  const auto difat_capacity = header.difat.size() + std::uint64_t{header.num_difat_sectors} * (entries_per_sector - 1);
+  if (header.num_fat_sectors > difat_capacity) [[unlikely]] {
+    return std::unexpected(ole::Error::CorruptedFile);
+  }
+  std::size_t expected_ids = std::min<std::size_t>(header.num_fat_sectors, header.difat.size());
+  if constexpr (requires { device.size(); }) {
+    const auto sectors = device.size() / sector_size;
+    if (std::uint64_t{header.num_fat_sectors} + header.num_difat_sectors > sectors) [[unlikely]] {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    expected_ids = header.num_fat_sectors;
+  }
+
+  // Список sector ID-ов FAT-секторов (строго по csectFat). Без size() у устройства список растёт по мере
+  // чтения DIFAT-секторов, а не по заявленному в заголовке
+  std::pmr::vector<fat_t> fat_sector_ids{resource};
+  fat_sector_ids.reserve(expected_ids + entries_per_sector);
 
   /**
    * Непонятно что делать, если в этой цепочке появляется FREESECT.
@@ -218,140 +547,219 @@ std::expected<std::vector<fat_t>, ole::Error> load_fat(Device &device, const Ole
   std::ranges::copy_if(header.difat, std::back_inserter(fat_sector_ids),
                        [](auto sector) { return sector != FREESECT; });
 
-  // читаем цепочку DIFAT-секторов
-  for (auto next_difat = header.first_difat_sector; next_difat != ENDOFCHAIN;) {
-    std::vector<fat_t> buf(sector_size / sizeof(fat_t));
-    if (!device.read_at(sector_offset(next_difat, sector_size), as_writable_bytes(std::span{buf}))) [[unlikely]] {
-      return std::unexpected(ole::Error::IoFailure);
+  // читаем цепочку DIFAT-секторов; длиннее заявленной она может быть только из-за цикла.
+  // Без DIFAT-секторов спецификация требует ENDOFCHAIN, но некоторые writer'ы пишут FREESECT
+  std::pmr::vector<fat_t> difat_sector_ids{resource};
+  for (auto next_difat = header.first_difat_sector; next_difat != ENDOFCHAIN && next_difat != FREESECT;) {
+    if (difat_sector_ids.size() == header.num_difat_sectors) [[unlikely]] {
+      return std::unexpected(ole::Error::CorruptedFile);
     }
+    difat_sector_ids.push_back(next_difat);
 
-    // читаем весь сектор
-    std::ranges::copy_if(buf, std::back_inserter(fat_sector_ids), [](auto sector) { return sector != FREESECT; });
+    // читаем весь сектор сразу в хвост списка, без промежуточного буфера
+    const auto tail = fat_sector_ids.size();
+    fat_sector_ids.resize(tail + entries_per_sector);
+    if (!device.read_at(sector_offset(next_difat, sector_size),
+                        as_writable_bytes(std::span{fat_sector_ids}.subspan(tail)))) [[unlikely]] {
+      return std::unexpected(ole::Error::IoFailure);
+    }
 
     // последняя uint32_t запись в секторе - это номер следующего difat сектора
     next_difat = fat_sector_ids.back();
     // удаляем последнюю запись, так как мы хотим хранить только fat сектора, а не служебные difat
     fat_sector_ids.pop_back();
+    const auto appended = fat_sector_ids.begin() + static_cast<std::ptrdiff_t>(tail);
+    fat_sector_ids.erase(std::remove(appended, fat_sector_ids.end(), FREESECT), fat_sector_ids.end());
   }
 
   if (fat_sector_ids.size() != header.num_fat_sectors) {
     return std::unexpected(ole::Error::CorruptedFile);
   }
 
-  // 2) Читаем сами FAT-сектора и склеиваем единый FAT
-  std::vector<fat_t> fat;
-  fat.reserve(fat_sector_ids.size() * sector_size / sizeof(uint32_t));
+  // 2) Читаем сами FAT-сектора одной пачкой сразу на их место в едином FAT
+  std::pmr::vector<fat_t> fat(fat_sector_ids.size() * entries_per_sector, resource);
+  if (!read_sectors(device, fat_sector_ids, sector_size, as_writable_bytes(std::span{fat}), executor)) [[unlikely]] {
+    return std::unexpected(ole::Error::IoFailure);
+  }
 
-  for (auto fat_sid : fat_sector_ids) {
-    std::vector<fat_t> buf(sector_size / sizeof(fat_t));
-    if (!device.read_at(sector_offset(fat_sid, sector_size), as_writable_bytes(std::span{buf}))) [[unlikely]] {
-      return std::unexpected(ole::Error::IoFailure);
+  if constexpr (Validate) {
+    if (const auto error = validate_fat(fat, fat_sector_ids, difat_sector_ids, resource); error != ole::Error::Success) {
+      return std::unexpected(error);
     }
-    std::ranges::copy(buf, std::back_inserter(fat));
-  }
-
-  // std::cout << std::format("number fat sectors: expected: {}, actual: {}", header.num_fat_sectors, size(fat)) << '\n';
-  // std::ranges::transform(fat, std::ostream_iterator<std::string>(std::cout, "\n"), [](auto v) -> std::string {
-  //   switch (v) {
-  //   case FREESECT:
-  //     return "FREESECT";
-  //   case FATSECT:
-  //     return "FATSECT";
-  //   case DIFSECT:
-  //     return "DIFSECT";
-  //   case ENDOFCHAIN:
-  //     return "ENDOFCHAIN";
-  //   default:
-  //     return std::format("{:08X}", v);
-  //   }
-  // });
-  // TODO валидация fat
+  }
   return fat;
 }
 
+/**
+ * Запись каталога в том виде, в каком она лежит в секторе: 128 байт little-endian, поля в порядке MS-CFB.
+ * FILETIME на диске начинаются со смещения 100, не кратного 8, поэтому хранятся половинами (младшая, старшая):
+ * так в структуре нет выравнивающих дыр и её можно получить wire_cast прямо из буфера.
+ */
 struct DirectoryEntryRaw {
+  std::array<std::byte, 64> name;
+  std::uint16_t name_size_in_bytes;
   std::byte object_type;
   std::byte color_flag;
-  std::uint16_t name_size_in_bytes;
-  std::array<std::byte, 16> clsid;
   std::uint32_t left_id;
   std::uint32_t right_id;
   std::uint32_t child_id;
+  std::array<std::byte, 16> clsid;
   std::uint32_t state_bits;
+  std::array<std::uint32_t, 2> creation_time;
+  std::array<std::uint32_t, 2> modified_time;
   std::uint32_t starting_sector;
-  std::uint64_t creation_time;
-  std::uint64_t modified_time;
   std::uint64_t stream_size; // in bytes
-  std::array<std::byte, 64> name;
-
-  auto operator<=>(const DirectoryEntryRaw &) const = default;
 };
 
-template <typename Device, bool Validate = true>
-std::expected<std::vector<DirectoryEntryRaw>, ole::Error> load_directories(Device &device, const OleHeader &header,
-                                                                      const std::vector<fat_t> &fat) {
-  const auto sector_size = 1 << header.sector_shift;
-  static_assert(sizeof(DirectoryEntryRaw) == 128);
-  // идём по FAT-цепочке, начиная с first_dir_sector. Alloc на 32 временно, потом надо посчитать на сколько именно
-  // аллокать
-  std::vector<DirectoryEntryRaw> dir_stream;
-  dir_stream.reserve(header.num_dir_sectors == 0 ? 32 : header.num_dir_sectors);
-
-  // TODO bitcast to wire type
-  for (auto next_sector = header.first_dir_sector; next_sector != ENDOFCHAIN; next_sector = fat[next_sector]) {
-    // The directory entry size is fixed at 128 bytes.
-    std::vector<DirectoryEntryRaw> buf(sector_size / sizeof(DirectoryEntryRaw));
-    if (!device.read_at(sector_offset(next_sector, sector_size), as_writable_bytes(std::span{buf}))) [[unlikely]] {
-      return std::unexpected(ole::Error::IoFailure);
-    }
+static_assert(sizeof(DirectoryEntryRaw) == 128 && offsetof(DirectoryEntryRaw, creation_time) == 100 &&
+              offsetof(DirectoryEntryRaw, stream_size) == 120);
 
-    std::ranges::move(buf, std::back_inserter(dir_stream));
+constexpr std::uint64_t filetime(const std::array<std::uint32_t, 2> &halves) noexcept {
+  return std::uint64_t{halves[1]} << 32 | halves[0];
+}
+
+// Запись из одних нулей (так некоторые writer'ы заполняют хвост последнего сектора каталога): OR по 8 байт
+inline bool is_zero_entry(std::span<const std::byte, sizeof(DirectoryEntryRaw)> bytes) noexcept {
+  const auto words = wire_cast<std::array<std::uint64_t, sizeof(DirectoryEntryRaw) / 8>>(bytes);
+  std::uint64_t any = 0;
+  for (const auto word : words) {
+    any |= word;
   }
+  return any == 0;
+}
 
-  for (auto&& dir : dir_stream) {
-    std::span<std::byte, sizeof(DirectoryEntryRaw)> view{reinterpret_cast<std::byte *>(std::addressof(dir)), sizeof(DirectoryEntryRaw)};
-    DirectoryEntryRaw entry{};
-    [[maybe_unused]] const auto tail = view
-    | entry.name
-    | entry.name_size_in_bytes
-    | entry.object_type
-    | entry.color_flag
-    | entry.left_id
-    | entry.right_id
-    | entry.child_id
-    | entry.clsid
-    | entry.state_bits
-    | entry.creation_time
-    | entry.modified_time
-    | entry.starting_sector
-    | entry.stream_size;
+// Запись каталога для драйвера: имя проверено и разобрано, размер потока приведён к версии файла
+inline std::expected<ole::DirectoryEntry, ole::Error> make_directory_entry(const DirectoryEntryRaw &entry,
+                                                                          const OleHeader &header) {
+  ole::DirectoryEntry result{};
+  result.type = static_cast<ole::file_type>(entry.object_type);
 
-    assert(empty(tail));
-    std::swap(entry, dir);
+  // Свободная запись остаётся на своём месте, чтобы не сдвигать идентификаторы, но имени у неё нет
+  if (result.type == ole::file_type::unknown_or_unallocated) {
+    result.left_id = result.right_id = result.child_id = ole::NOSTREAM;
+    return result;
   }
 
-  std::erase(dir_stream, DirectoryEntryRaw {});
-  // TODO directory entry validation
+  auto name = ole::String::make(entry.name, entry.name_size_in_bytes);
+  if (not name) {
+    return std::unexpected(name.error());
+  }
 
-  return dir_stream;
+  result.name = std::move(*name);
+  result.left_id = entry.left_id;
+  result.right_id = entry.right_id;
+  result.child_id = entry.child_id;
+  result.starting_sector = entry.starting_sector;
+  result.creation_time = filetime(entry.creation_time);
+  result.modified_time = filetime(entry.modified_time);
+  // В версии 3 старшие 32 бита размера могут быть мусором от старых реализаций, спецификация советует их игнорировать
+  result.stream_size = header.major_version == 3 ? entry.stream_size & 0xFFFFFFFF : entry.stream_size;
+  return result;
 }
 
-template <typename Device, bool Validate = true>
-std::expected<std::vector<fat_t>, ole::Error> load_minifat(Device &device, int sector_size, uint32_t first_mini_fat_sector, uint32_t num_mini_fat_sectors, uint32_t mini_sectors_count, const std::vector<fat_t> &fat) {
-  std::vector<fat_t> result; result.reserve(num_mini_fat_sectors);
+/**
+ * Результат file_size для записи: размер потока или -1, если это не поток. В версии 4 поток может быть больше
+ * INT_MAX, а file_size возвращает int, поэтому такой размер тоже -1, а не обрезанное значение.
+ */
+inline int stream_file_size(const ole::DirectoryEntry &entry) noexcept {
+  if (entry.type != ole::file_type::regular || entry.stream_size > std::uint64_t{std::numeric_limits<int>::max()}) {
+    return -1;
+  }
+  return static_cast<int>(entry.stream_size);
+}
 
-  // читаем цепочку miniFAT-секторов
-  for (auto next_sector = first_mini_fat_sector; next_sector != ENDOFCHAIN; next_sector = fat[next_sector]) {
-    std::vector<fat_t> buf(sector_size / sizeof(fat_t));
-    if (!device.read_at(sector_offset(next_sector, sector_size), as_writable_bytes(std::span{buf}))) [[unlikely]] {
+// Запись каталога прямо из 128 байт сектора
+inline std::expected<ole::DirectoryEntry, ole::Error> decode_directory_entry(
+    std::span<const std::byte, sizeof(DirectoryEntryRaw)> bytes, const OleHeader &header) {
+  return make_directory_entry(wire_cast<DirectoryEntryRaw>(bytes), header);
+}
+
+/**
+ * Каталог за один проход: каждая запись из байт сектора сразу становится ole::DirectoryEntry в своём слоте
+ * (с executor - параллельно, кусками по kEntriesPerTask). Нулевые записи в хвосте отбрасываются,
+ * нулевые в середине остаются свободными на своём месте, чтобы не сдвигать идентификаторы.
+ * Записи и буфер секторов берутся из resource.
+ */
+template <typename Device, bool Validate = true, containerfs::Executor E = containerfs::InlineExecutor>
+std::expected<std::pmr::vector<ole::DirectoryEntry>, ole::Error> load_directories(
+    Device &device, const OleHeader &header, std::span<const fat_t> fat, E &&executor = {},
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+  const auto sector_size = 1 << header.sector_shift;
+  // цепочка каталога целиком известна из FAT, начиная с first_dir_sector
+  const auto chain = sector_chain(fat, header.first_dir_sector, header.num_dir_sectors, resource);
+  if (not chain) {
+    return std::unexpected(chain.error());
+  }
+
+  // Для ViewableDevice разбираем каталог прямо в устройстве, иначе читаем все сектора одной пачкой
+  std::pmr::vector<std::byte> buffer{resource};
+  std::span<const std::byte> bytes;
+  if constexpr (containerfs::ViewableDevice<Device>) {
+    // отображение непрерывно, поэтому непрерывную цепочку можно отдать одним span
+    if (std::ranges::adjacent_find(*chain, [](auto a, auto b) { return b != a + 1; }) == chain->end() && !chain->empty()) {
+      bytes = device.view_at(sector_offset(chain->front(), sector_size), chain->size() * sector_size);
+      if (bytes.size() != chain->size() * sector_size) [[unlikely]] {
+        return std::unexpected(ole::Error::IoFailure);
+      }
+    }
+  }
+  if (bytes.empty()) {
+    buffer.resize(chain->size() * sector_size);
+    if (!read_sectors(device, *chain, sector_size, buffer, executor)) [[unlikely]] {
       return std::unexpected(ole::Error::IoFailure);
     }
-    // читаем весь сектор
-    std::ranges::copy_if(buf, std::back_inserter(result), [](auto sector) { return sector != FREESECT; });
+    bytes = buffer;
   }
 
+  // The directory entry size is fixed at 128 bytes.
+  const auto entry_bytes = [&](std::size_t i) {
+    return bytes.subspan(i * sizeof(DirectoryEntryRaw)).template first<sizeof(DirectoryEntryRaw)>();
+  };
+  auto count = bytes.size() / sizeof(DirectoryEntryRaw);
+  while (count != 0 && is_zero_entry(entry_bytes(count - 1))) {
+    --count;
+  }
+
+  std::pmr::vector<ole::DirectoryEntry> dirs(count, resource);
+  std::atomic<ole::Error> error = ole::Error::Success;
+  for_each_chunk(executor, count, kEntriesPerTask, [&](std::size_t first, std::size_t last) {
+    for (auto i = first; i < last; ++i) {
+      auto entry = decode_directory_entry(entry_bytes(i), header);
+      if (not entry) {
+        error.store(entry.error(), std::memory_order_relaxed);
+        return;
+      }
+      dirs[i] = *entry;
+    }
+  });
+  if (const auto failed = error.load(std::memory_order_relaxed); failed != ole::Error::Success) {
+    return std::unexpected(failed);
+  }
   if constexpr (Validate) {
-    if (result.size() != mini_sectors_count) {
+    if (const auto tree = ole::validate_directory(dirs); tree != ole::Error::Success) {
+      return std::unexpected(tree);
+    }
+  }
+
+  return dirs;
+}
+
+template <typename Device, bool Validate = true>
+std::expected<std::pmr::vector<fat_t>, ole::Error> load_minifat(Device &device, int sector_size, uint32_t first_mini_fat_sector, uint32_t num_mini_fat_sectors, uint32_t mini_sectors_count, std::span<const fat_t> fat,
+                                                                std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+  // читаем цепочку miniFAT-секторов одной пачкой
+  const auto chain = sector_chain(fat, first_mini_fat_sector, num_mini_fat_sectors, resource);
+  if (not chain) {
+    return std::unexpected(chain.error());
+  }
+  std::pmr::vector<fat_t> result(chain->size() * sector_size / sizeof(fat_t), resource);
+  if (!read_sectors(device, *chain, sector_size, as_writable_bytes(std::span{result}))) [[unlikely]] {
+    return std::unexpected(ole::Error::IoFailure);
+  }
+
+  if constexpr (Validate) {
+    // свободные записи остаются на месте: индекс в miniFAT - это номер мини-сектора
+    if (std::ranges::count_if(result, [](auto sector) { return sector != FREESECT; }) != mini_sectors_count) {
       return std::unexpected(ole::Error::CorruptedFile);
     }
   }
@@ -359,86 +767,886 @@ std::expected<std::vector<fat_t>, ole::Error> load_minifat(Device &device, int s
   return result;
 }
 
-template <typename Device> class OleDriver final {
+template <typename Device> class OleStreamDevice;
+template <typename Device> class OleChunkRange;
+
+/**
+ * Мини-поток целиком: байты цепочки корневой записи размером stream_size корня.
+ * Для ViewableDevice непрерывная цепочка отдаётся как view без копирования (buffer остаётся пустым),
+ * иначе читается одной пачкой read_many в buffer.
+ */
+struct MiniStream {
+  std::pmr::vector<std::byte> buffer;
+  std::span<const std::byte> bytes;
+};
+
+template <typename Device, bool Validate = true>
+std::expected<MiniStream, ole::Error> load_ministream(Device &device, const ExtentIndex &root_index, std::uint64_t size,
+                                                     std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+  MiniStream result{std::pmr::vector<std::byte>{resource}, {}};
+  if (size == 0) {
+    return result;
+  }
+  if (root_index.size() < size) {
+    return std::unexpected(ole::Error::CorruptedFile);
+  }
+
+  if constexpr (containerfs::ViewableDevice<Device>) {
+    if (const auto entries = root_index.entries(); entries.size() == 1) {
+      result.bytes = device.view_at(sector_offset(entries.front().first, root_index.unit_size()), size);
+      if (result.bytes.size() == size) {
+        return result;
+      }
+    }
+  }
+
+  result.buffer.resize(size);
+  std::vector<containerfs::ReadRequest> requests;
+  if (not root_index.append_requests(0, result.buffer, requests) || not containerfs::read_many(device, requests)) [[unlikely]] {
+    return std::unexpected(ole::Error::IoFailure);
+  }
+  result.bytes = result.buffer;
+  return result;
+}
+
+/**
+ * Чтения потоков по пути, общие для OleDriver и LazyOleDriver: драйвер отличается только тем, как путь превращается
+ * в запросы к устройству. Derived даёт plan_stream(path, offset, target, requests): находит поток, проверяет его
+ * цепочку, берёт у target(сколько байт потока есть после offset) буфер и добавляет запросы, которые его заполнят
+ * (или заполняет его сам), возвращая его размер; и dev_, куда эти запросы уходят.
+ */
+template <typename Derived> class OleStreamReads {
 public:
   using error_type = ole::Error;
 
-  static std::expected<OleDriver, error_type> create(Device &&dev) {
+  // Одно чтение на непрерывный участок потока, прямо в результат размером stream_size
+  std::vector<std::byte> read_file(const std::filesystem::path &path) {
+    auto plan = plan_read(path);
+    if (not plan || not read_with_prefetch(self().dev_, plan->requests)) {
+      return {};
+    }
+    return std::move(plan->buffer);
+  }
+
+  // То же, но память результата берётся из resource (пустой вектор при ошибке)
+  std::pmr::vector<std::byte> read_file(const std::filesystem::path &path, std::pmr::memory_resource *resource) {
+    std::pmr::vector<std::byte> result{resource};
+    const auto read = read_stream(path, 0, [&](std::uint64_t size) -> std::expected<std::span<std::byte>, error_type> {
+      result.resize(size);
+      return result;
+    });
+    if (not read) {
+      result.clear();
+    }
+    return result;
+  }
+
+  // Поток целиком в буфер вызывающего, без аллокаций; BufferTooSmall, если dst меньше потока
+  std::expected<std::size_t, error_type> read_into(const std::filesystem::path &path, std::span<std::byte> dst) {
+    return read_stream(path, 0, [&](std::uint64_t size) -> std::expected<std::span<std::byte>, error_type> {
+      if (dst.size() < size) {
+        return std::unexpected(ole::Error::BufferTooSmall);
+      }
+      return dst.first(static_cast<std::size_t>(size));
+    });
+  }
+
+  /**
+   * Байты потока с offset в dst, как pread: читаются только сектора, которые пересекают диапазон.
+   * Возвращает число прочитанных байт, меньше dst.size() у конца потока.
+   */
+  std::expected<std::size_t, error_type> read_range(const std::filesystem::path &path, std::uint64_t offset,
+                                                    std::span<std::byte> dst) {
+    return read_stream(path, offset, [&](std::uint64_t size) -> std::expected<std::span<std::byte>, error_type> {
+      return dst.first(static_cast<std::size_t>(std::min<std::uint64_t>(size, dst.size())));
+    });
+  }
+
+  /**
+   * Все запросы потока уходят в устройство одной пачкой через read_many_async, done получает содержимое
+   * (пустое при ошибке) из потока завершения устройства. Драйвер должен пережить все свои чтения.
+   */
+  void read_file_async(const std::filesystem::path &path, containerfs::ReadFileCompletion done) {
+    auto plan = plan_read(path);
+    if (not plan) {
+      done({});
+      return;
+    }
+
+    // план живёт в куче до завершения: запросы ссылаются на его буфер
+    auto state = std::make_unique<ReadPlan>(std::move(*plan));
+    const std::span<const containerfs::ReadRequest> requests{state->requests};
+    containerfs::read_many_async(self().dev_, requests, [state = std::move(state), done = std::move(done)](bool ok) mutable {
+      if (not ok) {
+        done({});
+        return;
+      }
+      done(std::move(state->buffer));
+    });
+  }
+
+private:
+  // Содержимое потока и запросы, которые его заполняют
+  struct ReadPlan {
+    std::vector<std::byte> buffer;
+    std::vector<containerfs::ReadRequest> requests;
+  };
+
+  Derived &self() noexcept { return static_cast<Derived &>(*this); }
+
+  std::optional<ReadPlan> plan_read(const std::filesystem::path &path) {
+    ReadPlan plan;
+    const auto planned = self().plan_stream(path, 0, [&](std::uint64_t size) -> std::expected<std::span<std::byte>, error_type> {
+      plan.buffer.resize(size);
+      return plan.buffer;
+    }, plan.requests);
+    if (not planned) {
+      return std::nullopt;
+    }
+    return plan;
+  }
+
+  // target(сколько байт потока есть после offset) возвращает, куда читать, или ошибку; результат - число байт
+  template <typename Target>
+  std::expected<std::size_t, error_type> read_stream(const std::filesystem::path &path, std::uint64_t offset,
+                                                     Target target) {
+    std::vector<containerfs::ReadRequest> requests;
+    const auto size = self().plan_stream(path, offset, std::move(target), requests);
+    if (not size) {
+      return std::unexpected(size.error());
+    }
+    if (not read_with_prefetch(self().dev_, requests)) {
+      return std::unexpected(ole::Error::IoFailure);
+    }
+    return size;
+  }
+};
+
+/**
+ * Драйвер OLE (Compound File Binary).
+ *
+ * create() разбирает заголовок, FAT и каталог целиком и строит индекс полных путей (ole::PathIndex),
+ * дальше они только читаются: const методы потокобезопасны.
+ * Индекс участков каждого потока строится при первом чтении и дальше переиспользуется (под std::call_once).
+ * Чтения по пути - из OleStreamReads; read_file и read_file_async потокобезопасны тогда и только тогда,
+ * когда Device удовлетворяет ConcurrentReadableDevice.
+ */
+template <typename Device> class OleDriver final : public OleStreamReads<OleDriver<Device>> {
+public:
+  using error_type = ole::Error;
+  using OleStreamReads<OleDriver>::read_range;
+
+  static constexpr std::size_t kDefaultChunkSize = std::size_t{1} << 20;
+
+  /**
+   * С executor (ThreadPool или любой тип с submit) FAT и каталог загружаются параллельно: mount<OleDriver>(dev, pool).
+   * Параллельно читаются только ConcurrentReadableDevice, для остальных параллелен лишь разбор каталога.
+   *
+   * Метаданные монтирования (FAT, miniFAT, каталог, мини-поток, индекс путей) и временные буферы загрузки
+   * берутся из resource: mount<OleDriver>(dev, pool, &arena). Без него у драйвера своя монотонная арена,
+   * размер первого блока которой оценивается по заголовку: монтирование обходится несколькими выделениями
+   * вместо сотен, а драйвер освобождает всё одним вызовом. Временные буферы при этом остаются в арене до конца.
+   * resource используется только внутри create() и только вызывающим потоком; чужой resource должен пережить драйвер.
+   * Индексы участков, которые строятся при чтении из разных потоков, выделяются из обычной кучи.
+   */
+  template <containerfs::Executor E = containerfs::InlineExecutor>
+  static std::expected<OleDriver, error_type> create(Device &&dev, E &&executor = {},
+                                                     std::pmr::memory_resource *resource = nullptr) {
     auto header = load_header(dev);
     if (not header) {
       return std::unexpected(header.error());
     }
 
-    auto fat = load_fat(dev, *header);
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    if (resource == nullptr) {
+      arena = std::make_unique<std::pmr::monotonic_buffer_resource>(arena_size(*header));
+      resource = arena.get();
+    }
+
+    auto fat = load_fat(dev, *header, executor, resource);
     if (not fat) {
       return std::unexpected(fat.error());
     }
 
-    auto directories = load_directories(dev, *header, *fat);
-    if (not directories) {
-      return std::unexpected(directories.error());
+    auto dirs = load_directories(dev, *header, *fat, executor, resource);
+    if (not dirs) {
+      return std::unexpected(dirs.error());
+    }
+    if (dirs->empty()) {
+      return std::unexpected(ole::Error::CorruptedFile);
     }
 
-    auto mini_sectors_count = directories->front().stream_size / (1 << header->mini_sector_shift);
-    auto minifat = load_minifat(dev, 1 << header->sector_shift, header->first_mini_fat_sector, header->num_mini_fat_sectors, mini_sectors_count, *fat);
+    auto mini_sectors_count = dirs->front().stream_size / (1 << header->mini_sector_shift);
+    auto minifat = load_minifat(dev, 1 << header->sector_shift, header->first_mini_fat_sector, header->num_mini_fat_sectors, mini_sectors_count, *fat, resource);
     if (not minifat) {
       return std::unexpected(minifat.error());
     }
 
-    std::vector<ole::DirectoryEntry> dirs; dirs.reserve(directories->size());
-    for (const auto& entry : *directories) {
-      ole::DirectoryEntry new_entry {};
+    // Мини-поток читается один раз: дальше маленькие потоки копируются из него без обращений к устройству
+    const auto root_chain = chain_extents(*fat, dirs->front().starting_sector);
+    if (not root_chain) {
+      return std::unexpected(root_chain.error());
+    }
+    const ExtentIndex root_index{*root_chain, static_cast<std::uint32_t>(1 << header->sector_shift)};
+    auto ministream = load_ministream(dev, root_index, dirs->front().stream_size, resource);
+    if (not ministream) {
+      return std::unexpected(ministream.error());
+    }
 
-      auto name = ole::String::make(entry.name, entry.name_size_in_bytes);
-      if (not name) {
-        return std::unexpected(name.error());
-      }
+    return OleDriver{std::move(dev), *header,
+                     std::make_unique<Metadata>(std::move(arena), std::move(*fat), std::move(*minifat),
+                                                std::move(*ministream), std::move(*dirs), resource)};
+  }
 
-      new_entry.type = static_cast<ole::file_type>(entry.object_type);
-      new_entry.name = std::move(*name);
-      new_entry.left_id = entry.left_id;
-      new_entry.right_id = entry.right_id;
-      new_entry.child_id = entry.child_id;
-      new_entry.starting_sector = entry.starting_sector;
-      new_entry.creation_time = entry.creation_time;
-      new_entry.modified_time = entry.modified_time;
-      new_entry.stream_size = entry.stream_size;
+  // Без executor, но со своим resource: mount<OleDriver>(dev, &arena)
+  static std::expected<OleDriver, error_type> create(Device &&dev, std::pmr::memory_resource *resource) {
+    return create(std::move(dev), containerfs::InlineExecutor{}, resource);
+  }
 
-      dirs.push_back(std::move(new_entry));
+  /**
+   * Поток как устройство: чтения транслируются через цепочку FAT или miniFAT потока прямо в устройство драйвера,
+   * так что вложенный контейнер монтируется без копии в память: mount<OleDriver>(*driver.open_stream(path)).
+   * Драйвер должен пережить устройство.
+   */
+  std::expected<OleStreamDevice<Device>, error_type> open_stream(const std::filesystem::path &path) {
+    const auto *entry = find(path);
+    if (entry == nullptr || entry->type != ole::file_type::regular) {
+      return std::unexpected(ole::Error::NotAStream);
+    }
+    // цепочка короче заявленного размера: такой поток нельзя читать целиком
+    if (entry->stream_size != 0 && extent_index(*entry).size() < entry->stream_size) {
+      return std::unexpected(ole::Error::CorruptedFile);
     }
+    return OleStreamDevice<Device>{*this, *entry};
+  }
 
-    // auto ministream = load_ministream(dev);
-    // if (not ministream) {
-    //   return std::unexpected(ministream.error());
-    // }
+  // Пути - ole::Path, std::filesystem::path или ole::PathView: поиск по индексу без аллокаций для любого из них
+  template <ole::PathLike P>
+  [[nodiscard]] bool exists(const P &path) const noexcept { return find(path) != nullptr; }
 
-    OleDriver driver{std::move(dev)};
-    driver.dirs_ = std::move(dirs);
+  // Размер потока или -1, если это не поток или он не помещается в int, см. stream_file_size
+  template <ole::PathLike P>
+  int file_size(const P &path) const noexcept {
+    const auto *entry = find(path);
+    return entry != nullptr ? stream_file_size(*entry) : -1;
+  }
 
-    return driver;
+  template <ole::PathLike P>
+  bool is_directory(const P &path) const noexcept {
+    const auto *entry = find(path);
+    return entry != nullptr && (entry->type == ole::file_type::directory || entry->type == ole::file_type::root);
   }
 
-  // --- публичный API (пока заглушки) ---
-  std::vector<std::byte> read_file(const std::filesystem::path &) { return {}; }
+  /**
+   * Все записи контейнера в глубину парами (путь, запись), без промежуточного списка: for (auto [path, entry] : ...).
+   * Путь действителен до следующего шага обхода.
+   */
+  [[nodiscard]] ole::RecursiveDirectoryView recursive_directory_view() const noexcept {
+    return ole::RecursiveDirectoryView{meta_->dirs};
+  }
 
-  [[nodiscard]] bool exists(const ole::Path& path) const noexcept {
-    using namespace std::ranges;
-    std::size_t root = dirs_.front().child_id;
+  /**
+   * Поток кусками по chunk_size байт (последний короче), см. OleChunkRange: память - два буфера независимо
+   * от размера потока, следующий кусок читается, пока разбирается текущий.
+   */
+  std::expected<OleChunkRange<Device>, error_type> read_chunks(const std::filesystem::path &path,
+                                                               std::size_t chunk_size = kDefaultChunkSize) {
+    const auto *entry = find(path);
+    if (entry == nullptr || entry->type != ole::file_type::regular) {
+      return std::unexpected(ole::Error::NotAStream);
+    }
+    if (extent_index(*entry).size() < entry->stream_size) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    return OleChunkRange<Device>{*this, *entry, std::max<std::size_t>(chunk_size, 1)};
+  }
 
-    ole::Path result;
-    for (auto[entry, _] : views::zip(PathResolve(dirs_, path, root), path)) {
-      result.append(entry.name);
+  /**
+   * Поток path в дескриптор out_fd (файл, сокет, канал) с его текущей позиции, без буфера на весь поток:
+   * участки обычных секторов идут через DescriptorSink (с устройства с дескриптором - силами ядра, мимо памяти
+   * процесса), маленькие потоки пишутся прямо из мини-потока. Возвращает число записанных байт.
+   */
+  std::expected<std::uint64_t, error_type> copy_stream_to(const std::filesystem::path &path, int out_fd) {
+    const auto *entry = find(path);
+    if (entry == nullptr || entry->type != ole::file_type::regular) {
+      return std::unexpected(ole::Error::NotAStream);
+    }
+    const auto &index = extent_index(*entry);
+    if (index.size() < entry->stream_size) {
+      return std::unexpected(ole::Error::CorruptedFile);
     }
 
-    return !result.empty() && result == path;
+    containerfs::DescriptorSink sink{out_fd};
+    const auto mini = entry->stream_size < header_.mini_stream_cutoff_size;
+    for (const auto &[offset, first, count] : index.entries()) {
+      if (offset >= entry->stream_size) {
+        break;
+      }
+      const auto size = std::min<std::uint64_t>(std::uint64_t{count} * index.unit_size(), entry->stream_size - offset);
+      if (not mini) {
+        if (not sink.copy_from(dev_, sector_offset(first, index.unit_size()), size)) {
+          return std::unexpected(ole::Error::IoFailure);
+        }
+        continue;
+      }
+      const auto from = std::uint64_t{first} * index.unit_size();
+      if (from > meta_->ministream.bytes.size() || size > meta_->ministream.bytes.size() - from) {
+        return std::unexpected(ole::Error::CorruptedFile);
+      }
+      if (not sink.write(meta_->ministream.bytes.subspan(static_cast<std::size_t>(from), static_cast<std::size_t>(size)))) {
+        return std::unexpected(ole::Error::IoFailure);
+      }
+    }
+    return sink.written();
   }
 
-  int file_size(const std::filesystem::path &) const noexcept { return -1; }
-  bool is_directory(const std::filesystem::path &) const noexcept { return false; }
+  /**
+   * Все потоки контейнера в каталог dest: хранилища становятся каталогами, потоки - файлами. Участки всех потоков
+   * планируются заранее, чтение идёт в порядке смещений на устройстве, запись - на потоках executor
+   * (см. containerfs::extract), buffer_size - размер одного буфера чтения. Время и объём - в ExtractStats.
+   */
+  template <containerfs::Executor E = containerfs::InlineExecutor>
+  std::expected<containerfs::ExtractStats, error_type> extract_all(const std::filesystem::path &dest, E &&executor = {},
+                                                                   std::size_t buffer_size = containerfs::kExtractBufferSize) {
+    return extract_from(0, dest, executor, buffer_size);
+  }
+
+  // То же для одного хранилища (его содержимое попадает прямо в dest) или одного потока (файл dest/<имя потока>)
+  template <containerfs::Executor E = containerfs::InlineExecutor>
+  std::expected<containerfs::ExtractStats, error_type> extract_subtree(const std::filesystem::path &path,
+                                                                       const std::filesystem::path &dest,
+                                                                       E &&executor = {},
+                                                                       std::size_t buffer_size = containerfs::kExtractBufferSize) {
+    const auto *entry = find(path);
+    if (entry == nullptr) {
+      return std::unexpected(ole::Error::NotFound);
+    }
+    return extract_from(static_cast<std::size_t>(entry - meta_->dirs.data()), dest, executor, buffer_size);
+  }
 
 private:
-  explicit OleDriver(Device &&dev) : dev_{std::move(dev)} {}
+  friend class OleStreamReads<OleDriver>;
+  friend class OleStreamDevice<Device>;
+  friend class OleChunkRange<Device>;
+
+  // Лениво построенный индекс участков одного потока
+  struct IndexSlot {
+    std::once_flag once;
+    ExtentIndex index;
+  };
+
+  // Первый блок собственной арены: FAT и miniFAT по заголовку и столько же на каталог и индекс путей
+  static constexpr std::size_t kMinArenaSize = std::size_t{16} << 10;
+  static constexpr std::size_t kMaxArenaSize = std::size_t{16} << 20;
+
+  /**
+   * Всё, что выделено из resource при монтировании, вместе с собственной ареной - один блок за unique_ptr.
+   * Перемещение драйвера переносит только указатель: polymorphic_allocator не переходит при присваивании
+   * перемещением, и контейнеры по отдельности освобождались бы через арену, которой уже нет.
+   * arena объявлена первой: контейнеры уничтожаются раньше, чем она освобождает их память.
+   * Контейнеры переносятся вместе с памятью: выделенное из resource остаётся в нём.
+   */
+  struct Metadata {
+    Metadata(std::unique_ptr<std::pmr::monotonic_buffer_resource> arena, std::pmr::vector<fat_t> &&fat,
+             std::pmr::vector<fat_t> &&minifat, MiniStream &&ministream, std::pmr::vector<ole::DirectoryEntry> &&dirs,
+             std::pmr::memory_resource *resource)
+        : arena{std::move(arena)}, fat{std::move(fat)}, minifat{std::move(minifat)}, ministream{std::move(ministream)},
+          dirs{std::move(dirs)}, paths{this->dirs, resource}, indexes{std::make_unique<IndexSlot[]>(this->dirs.size())} {}
+
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena; // нет, если resource передан снаружи
+    std::pmr::vector<fat_t> fat;
+    std::pmr::vector<fat_t> minifat;
+    MiniStream ministream;
+    std::pmr::vector<ole::DirectoryEntry> dirs;
+    ole::PathIndex paths;
+    std::unique_ptr<IndexSlot[]> indexes;
+  };
+
+  OleDriver(Device &&dev, const OleHeader &header, std::unique_ptr<Metadata> meta)
+      : dev_{std::move(dev)}, header_{header}, meta_{std::move(meta)} {}
+
+  static std::size_t arena_size(const OleHeader &header) noexcept {
+    const auto sector_size = std::uint64_t{1} << header.sector_shift;
+    const auto fat_bytes = (std::uint64_t{header.num_fat_sectors} + header.num_mini_fat_sectors) * sector_size;
+    return static_cast<std::size_t>(std::clamp<std::uint64_t>(fat_bytes * 2, kMinArenaSize, kMaxArenaSize));
+  }
+
+  // Индекс участков потока entry: по FAT для обычных потоков, по miniFAT (в мини-секторах) для маленьких
+  [[nodiscard]] const ExtentIndex &extent_index(const ole::DirectoryEntry &entry) const {
+    auto &slot = meta_->indexes[static_cast<std::size_t>(std::addressof(entry) - meta_->dirs.data())];
+    std::call_once(slot.once, [&] {
+      // испорченная цепочка даёт пустой индекс: поток короче stream_size не читается
+      if (entry.stream_size >= header_.mini_stream_cutoff_size) {
+        if (const auto extents = chain_extents(meta_->fat, entry.starting_sector)) {
+          slot.index = ExtentIndex{*extents, 1u << header_.sector_shift};
+        }
+      } else if (const auto extents = chain_extents(meta_->minifat, entry.starting_sector)) {
+        slot.index = ExtentIndex{*extents, 1u << header_.mini_sector_shift};
+      }
+    });
+    return slot.index;
+  }
+
+  // Запись каталога по пути или nullptr: одна проба в индексе путей, без аллокаций
+  template <typename P>
+  [[nodiscard]] const ole::DirectoryEntry *find(const P &path) const noexcept {
+    const auto id = meta_->paths.find(meta_->dirs, path);
+    return id == ole::NOSTREAM ? nullptr : std::addressof(meta_->dirs[id]);
+  }
+
+  template <containerfs::Executor E>
+  std::expected<containerfs::ExtractStats, error_type> extract_from(std::size_t id, const std::filesystem::path &dest,
+                                                                    E &executor, std::size_t buffer_size) {
+    const auto plan = plan_extract(id, dest);
+    if (not plan) {
+      return std::unexpected(plan.error());
+    }
+    containerfs::ExtractStats stats;
+    if (not containerfs::extract(dev_, *plan, executor, stats, buffer_size)) {
+      return std::unexpected(ole::Error::IoFailure);
+    }
+    return stats;
+  }
+
+  // План извлечения записи id: для хранилища - всё его содержимое, для потока - он сам
+  [[nodiscard]] std::expected<containerfs::ExtractPlan, error_type> plan_extract(std::size_t id,
+                                                                                 const std::filesystem::path &dest) const {
+    containerfs::ExtractPlan plan;
+    plan.directories.push_back(dest);
+    const auto add = [&](std::u16string_view relative, const ole::DirectoryEntry &entry) {
+      // "." и ".." - допустимые имена OLE, но на диске они вывели бы запись за пределы dest
+      const std::u16string_view name = entry.name;
+      if (name == u"." || name == u"..") {
+        return ole::Error::ContainsIllegalCharacters;
+      }
+      std::filesystem::path target;
+      try {
+        target = dest / std::filesystem::path{relative};
+      } catch (const std::system_error &) {
+        // непарные суррогаты не переводятся в кодировку файловой системы
+        return ole::Error::ContainsIllegalCharacters;
+      }
+      if (entry.type == ole::file_type::directory) {
+        plan.directories.push_back(std::move(target));
+        return ole::Error::Success;
+      }
+      return plan_stream(entry, std::move(target), plan);
+    };
+
+    const auto &entry = meta_->dirs[id];
+    auto error = ole::Error::Success;
+    if (entry.type == ole::file_type::regular) {
+      error = add(entry.name, entry);
+    } else {
+      for (const auto &[path, child] : ole::RecursiveDirectoryView{meta_->dirs, id}) {
+        if (error = add(path.str(), child); error != ole::Error::Success) {
+          break;
+        }
+      }
+    }
+    if (error != ole::Error::Success) {
+      return std::unexpected(error);
+    }
+    return plan;
+  }
+
+  // Файл потока и его куски: участки обычных секторов читаются с устройства, маленькие потоки - из мини-потока
+  ole::Error plan_stream(const ole::DirectoryEntry &entry, std::filesystem::path target,
+                         containerfs::ExtractPlan &plan) const {
+    const auto file = static_cast<std::uint32_t>(plan.files.size());
+    plan.files.push_back({std::move(target), entry.stream_size});
+    if (entry.stream_size == 0) {
+      return ole::Error::Success;
+    }
+    const auto &index = extent_index(entry);
+    if (index.size() < entry.stream_size) {
+      return ole::Error::CorruptedFile;
+    }
+
+    const auto mini = entry.stream_size < header_.mini_stream_cutoff_size;
+    for (const auto &[offset, first, count] : index.entries()) {
+      if (offset >= entry.stream_size) {
+        break;
+      }
+      auto &piece = plan.pieces.emplace_back();
+      piece.file = file;
+      piece.file_offset = offset;
+      piece.size = std::min<std::uint64_t>(std::uint64_t{count} * index.unit_size(), entry.stream_size - offset);
+      if (not mini) {
+        piece.offset = sector_offset(first, index.unit_size());
+        continue;
+      }
+      const auto from = std::uint64_t{first} * index.unit_size();
+      if (from > meta_->ministream.bytes.size() || piece.size > meta_->ministream.bytes.size() - from) {
+        return ole::Error::CorruptedFile;
+      }
+      piece.memory = meta_->ministream.bytes.data() + from;
+    }
+    return ole::Error::Success;
+  }
+
+  // Путь -> запросы для OleStreamReads: индекс путей, индекс участков потока и plan_range
+  template <typename Target>
+  std::expected<std::size_t, error_type> plan_stream(const std::filesystem::path &path, std::uint64_t offset,
+                                                     Target target, std::vector<containerfs::ReadRequest> &requests) const {
+    const auto *entry = find(path);
+    if (entry == nullptr || entry->type != ole::file_type::regular) {
+      return std::unexpected(ole::Error::NotAStream);
+    }
+    // размер проверяем до аллокации в target: stream_size из файла может быть любым
+    if (extent_index(*entry).size() < entry->stream_size) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+
+    offset = std::min(offset, entry->stream_size);
+    const auto dst = target(entry->stream_size - offset);
+    if (not dst) {
+      return std::unexpected(dst.error());
+    }
+    if (not plan_range(*entry, offset, *dst, requests)) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    return dst->size();
+  }
+
+  // Запросы на чтение байт [pos, pos + dst.size()) потока entry в dst; байты маленьких потоков копируются в dst сразу
+  bool plan_range(const ole::DirectoryEntry &entry, std::uint64_t pos, std::span<std::byte> dst,
+                  std::vector<containerfs::ReadRequest> &requests) const {
+    const auto &index = extent_index(entry);
+    if (entry.stream_size >= header_.mini_stream_cutoff_size) {
+      return index.append_requests(pos, dst, requests);
+    }
+
+    // маленький поток копируется сразу из загруженного мини-потока, запросов к устройству не добавляется
+    if (dst.size() > index.size() || pos > index.size() - dst.size()) {
+      return false;
+    }
+    const auto mini_sector_size = std::uint64_t{1} << header_.mini_sector_shift;
+    const auto ministream = meta_->ministream.bytes;
+    for (auto it = index.locate(pos); not dst.empty(); ++it) {
+      const auto skip = pos - it->offset;
+      const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(it->count * mini_sector_size - skip, dst.size()));
+      const auto from = it->first * mini_sector_size + skip;
+      if (from > ministream.size() || size > ministream.size() - from) {
+        return false;
+      }
+      std::ranges::copy(ministream.subspan(static_cast<std::size_t>(from), size), dst.begin());
+      dst = dst.subspan(size);
+      pos += size;
+    }
+    return true;
+  }
+
+  // Байты [pos, pos + dst.size()) потока entry одной пачкой read_many
+  bool read_range(const ole::DirectoryEntry &entry, std::uint64_t pos, std::span<std::byte> dst) {
+    std::vector<containerfs::ReadRequest> requests;
+    return plan_range(entry, pos, dst, requests) && read_with_prefetch(dev_, requests);
+  }
+
+  // То же для пачки диапазонов: все чтения уходят в устройство одним read_many
+  bool read_ranges(const ole::DirectoryEntry &entry, std::span<const containerfs::ReadRequest> ranges) {
+    std::vector<containerfs::ReadRequest> requests;
+    requests.reserve(ranges.size());
+    for (const auto &[offset, dst] : ranges) {
+      if (not plan_range(entry, offset, dst, requests)) {
+        return false;
+      }
+    }
+    return read_with_prefetch(dev_, requests);
+  }
+
+  // Подсказывает устройству байты [pos, pos + size) потока entry; маленькие потоки уже в памяти
+  void prefetch_range(const ole::DirectoryEntry &entry, std::uint64_t pos, std::uint64_t size) {
+    if constexpr (containerfs::PrefetchableDevice<Device>) {
+      if (entry.stream_size < header_.mini_stream_cutoff_size) {
+        return;
+      }
+      const auto &index = extent_index(entry);
+      size = std::min(size, index.size() - std::min(pos, index.size()));
+      for (auto it = index.locate(pos); size != 0; ++it) {
+        const auto skip = pos - it->offset;
+        const auto part = std::min<std::uint64_t>(std::uint64_t{it->count} * index.unit_size() - skip, size);
+        dev_.prefetch(sector_offset(it->first, index.unit_size()) + skip, part);
+        pos += part;
+        size -= part;
+      }
+    }
+  }
 
   Device dev_;
-  std::vector<ole::DirectoryEntry> dirs_ {};
+  OleHeader header_ {};
+  std::unique_ptr<Metadata> meta_;
+};
+
+/**
+ * Поток OLE как ReadableDevice: read_at(off, dst) читает байты потока по его индексу участков,
+ * поэтому поток любого размера можно смонтировать как вложенный контейнер без копии в память.
+ *
+ * Последовательное чтение (каждое read_at начинается там, где кончилось предыдущее) включает упреждающее чтение:
+ * следующие read_ahead секторов цепочки заранее подсказываются устройству драйвера (PrefetchableDevice),
+ * окно сдвигается, когда чтение проходит его половину. Для устройств без prefetch и маленьких потоков это ничего не стоит.
+ *
+ * Устройство - лёгкая ссылка на драйвер и запись каталога, его можно копировать; драйвер должен его пережить.
+ * Потокобезопасно ровно тогда, когда потокобезопасно устройство драйвера.
+ */
+template <typename Device> class OleStreamDevice final {
+public:
+  static constexpr std::uint32_t kDefaultReadAhead = 64; // секторов
+
+  OleStreamDevice(const OleStreamDevice &other) noexcept
+      : driver_{other.driver_}, entry_{other.entry_}, read_ahead_{other.read_ahead_} {}
+
+  OleStreamDevice &operator=(const OleStreamDevice &other) noexcept {
+    driver_ = other.driver_;
+    entry_ = other.entry_;
+    read_ahead_ = other.read_ahead_;
+    next_ = 0;
+    prefetched_ = 0;
+    return *this;
+  }
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) const
+    requires containerfs::ConcurrentReadableDevice<Device>
+  {
+    return read(off, dst);
+  }
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst)
+    requires (not containerfs::ConcurrentReadableDevice<Device>)
+  {
+    return read(off, dst);
+  }
+
+  bool read_many(std::span<const containerfs::ReadRequest> requests) const
+    requires containerfs::ConcurrentReadableDevice<Device>
+  {
+    return std::ranges::all_of(requests, [this](const auto &r) { return in_range(r.offset, r.dst.size()); }) &&
+           driver_->read_ranges(*entry_, requests);
+  }
+
+  bool read_many(std::span<const containerfs::ReadRequest> requests)
+    requires (not containerfs::ConcurrentReadableDevice<Device>)
+  {
+    return std::ranges::all_of(requests, [this](const auto &r) { return in_range(r.offset, r.dst.size()); }) &&
+           driver_->read_ranges(*entry_, requests);
+  }
+
+  void prefetch(std::uint64_t off, std::uint64_t size) const
+    requires containerfs::PrefetchableDevice<Device>
+  {
+    driver_->prefetch_range(*entry_, off, size);
+  }
+
+  // Глубина упреждающего чтения в секторах, 0 - выключено
+  void set_read_ahead(std::uint32_t sectors) noexcept { read_ahead_ = sectors; }
+
+  [[nodiscard]] std::uint64_t size() const noexcept { return entry_->stream_size; }
+
+private:
+  friend class OleDriver<Device>;
+
+  OleStreamDevice(OleDriver<Device> &driver, const ole::DirectoryEntry &entry)
+      : driver_{std::addressof(driver)}, entry_{std::addressof(entry)} {}
+
+  [[nodiscard]] bool in_range(std::uint64_t off, std::size_t size) const noexcept {
+    return size <= entry_->stream_size && off <= entry_->stream_size - size;
+  }
+
+  bool read(std::uint64_t off, std::span<std::byte> dst) const {
+    if (not in_range(off, dst.size())) {
+      return false;
+    }
+
+    const auto end = off + dst.size();
+    if constexpr (containerfs::PrefetchableDevice<Device>) {
+      // состояние окна - только эвристика: гонки между потоками могут лишь сдвинуть подсказку
+      if (read_ahead_ != 0 && next_.exchange(end, std::memory_order_relaxed) == off) {
+        const auto window = std::uint64_t{read_ahead_} << driver_->header_.sector_shift;
+        if (const auto prefetched = prefetched_.load(std::memory_order_relaxed); end + window / 2 > prefetched) {
+          const auto from = std::max(end, prefetched);
+          driver_->prefetch_range(*entry_, from, end + window - from);
+          prefetched_.store(end + window, std::memory_order_relaxed);
+        }
+      }
+    }
+    return driver_->read_range(*entry_, off, dst);
+  }
+
+  OleDriver<Device> *driver_;
+  const ole::DirectoryEntry *entry_;
+  std::uint32_t read_ahead_ = kDefaultReadAhead;
+  mutable std::atomic<std::uint64_t> next_ = 0;       // где кончилось предыдущее чтение
+  mutable std::atomic<std::uint64_t> prefetched_ = 0; // до какого байта потока уже подсказано
+};
+
+/**
+ * Поток OLE кусками: input range из std::span<const std::byte> по chunk_size байт, последний кусок короче.
+ * Годится для std::ranges алгоритмов; память - два буфера по chunk_size, сколько бы ни весил поток.
+ *
+ * Буферы меняются ролями: пока потребитель разбирает кусок в одном, в другой уже читается следующий.
+ * У AsyncReadableDevice (IoUringDevice) это настоящее асинхронное чтение через read_many_async, у остальных
+ * устройств участки следующего куска заранее подсказываются через prefetch, а читаются при переходе к нему.
+ * Куски маленьких потоков копируются из мини-потока в памяти.
+ *
+ * span куска действителен до следующего ++. Ошибка чтения заканчивает обход, failed() отличает её от конца потока.
+ * Range только перемещается, итераторы при этом остаются действительными; драйвер должен его пережить.
+ * Деструктор дожидается чтений, которые ещё идут.
+ */
+template <typename Device> class OleChunkRange final : public std::ranges::view_interface<OleChunkRange<Device>> {
+  struct State;
+
+public:
+  class iterator {
+  public:
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = std::span<const std::byte>;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+
+    value_type operator*() const noexcept { return state_->current(); }
+
+    iterator &operator++() {
+      state_->advance();
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    // итератор по умолчанию ни на что не указывает и уже в конце
+    bool operator==([[maybe_unused]] std::default_sentinel_t unused) const noexcept {
+      return state_ == nullptr || state_->done();
+    }
+
+  private:
+    friend class OleChunkRange;
+    explicit iterator(State *state) noexcept : state_{state} {}
+
+    State *state_ = nullptr;
+  };
+
+  OleChunkRange(OleChunkRange &&) noexcept = default;
+  OleChunkRange &operator=(OleChunkRange &&) noexcept = default;
+
+  // Первый вызов запускает чтение первых двух кусков
+  [[nodiscard]] iterator begin() {
+    state_->start();
+    return iterator{state_.get()};
+  }
+  [[nodiscard]] std::default_sentinel_t end() const noexcept { return {}; }
+
+  [[nodiscard]] bool failed() const noexcept { return state_->failed; }
+  [[nodiscard]] std::size_t chunk_size() const noexcept { return state_->chunk_size; }
+
+private:
+  friend class OleDriver<Device>;
+
+  // Буфер и кусок потока, который в него читается
+  struct Slot {
+    std::unique_ptr<std::byte[]> buffer;
+    std::size_t size = 0;
+    std::vector<containerfs::ReadRequest> requests; // чтения, которые ещё не выполнены (синхронные устройства)
+    bool pending = false;                           // идёт асинхронное чтение
+    bool ok = true;
+  };
+
+  struct State {
+    State(OleDriver<Device> &driver, const ole::DirectoryEntry &entry, std::size_t chunk_size)
+        : driver{std::addressof(driver)}, entry{std::addressof(entry)},
+          chunk_size{static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size, entry.stream_size))} {
+      for (auto &slot : slots) {
+        slot.buffer = std::make_unique_for_overwrite<std::byte[]>(this->chunk_size);
+      }
+    }
+
+    State(const State &) = delete;
+    State &operator=(const State &) = delete;
+
+    ~State() {
+      std::unique_lock lock{mutex};
+      cv.wait(lock, [this] { return std::ranges::none_of(slots, &Slot::pending); });
+    }
+
+    void start() {
+      if (started) {
+        return;
+      }
+      started = true;
+      issue(slots[0]);
+      issue(slots[1]);
+      wait(slots[0]);
+    }
+
+    // Потребитель закончил с текущим буфером: следующий кусок уже читается в другой, а этот занимает кусок после него
+    void advance() {
+      if (done()) {
+        return;
+      }
+      auto &finished = slots[active];
+      active ^= 1;
+      wait(slots[active]);
+      issue(finished);
+    }
+
+    [[nodiscard]] bool done() const noexcept { return failed || slots[active].size == 0; }
+    [[nodiscard]] std::span<const std::byte> current() const noexcept {
+      return {slots[active].buffer.get(), slots[active].size};
+    }
+
+    // Начинает чтение куска с next в slot
+    void issue(Slot &slot) {
+      slot.size = static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size, entry->stream_size - next));
+      slot.requests.clear();
+      if (slot.size == 0) {
+        return;
+      }
+      if (not driver->plan_range(*entry, next, {slot.buffer.get(), slot.size}, slot.requests)) {
+        failed = true;
+        return;
+      }
+      next += slot.size;
+
+      if constexpr (containerfs::AsyncReadableDevice<Device>) {
+        {
+          std::lock_guard lock{mutex};
+          slot.pending = true;
+        }
+        containerfs::read_many_async(driver->dev_, slot.requests, [this, &slot](bool ok) {
+          std::lock_guard lock{mutex};
+          slot.ok = ok;
+          slot.pending = false;
+          cv.notify_all();
+        });
+      } else {
+        containerfs::prefetch(driver->dev_, slot.requests);
+      }
+    }
+
+    // Дожидается куска в slot; у синхронных устройств здесь и идёт чтение
+    void wait(Slot &slot) {
+      if constexpr (containerfs::AsyncReadableDevice<Device>) {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&] { return not slot.pending; });
+        failed = failed || not slot.ok;
+      } else {
+        failed = failed || not containerfs::read_many(driver->dev_, slot.requests);
+      }
+    }
+
+    OleDriver<Device> *driver;
+    const ole::DirectoryEntry *entry;
+    std::size_t chunk_size;
+    std::array<Slot, 2> slots;
+    std::size_t active = 0; // буфер с текущим куском
+    std::uint64_t next = 0; // начало куска, который ещё не начат
+    bool started = false;
+    bool failed = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+
+  OleChunkRange(OleDriver<Device> &driver, const ole::DirectoryEntry &entry, std::size_t chunk_size)
+      : state_{std::make_unique<State>(driver, entry, chunk_size)} {}
+
+  std::unique_ptr<State> state_;
 };
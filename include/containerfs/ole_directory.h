@@ -4,7 +4,14 @@
 #include "ole_string.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 namespace ole {
@@ -32,24 +39,59 @@ struct DirectoryEntry {
   std::uint64_t stream_size;
 };
 
+// Имя хранится в записи: каталог целиком - один непрерывный массив без аллокаций на запись
+static_assert(std::is_trivially_copyable_v<DirectoryEntry>);
+
 inline bool has_children(const DirectoryEntry& entry) noexcept { return entry.child_id != NOSTREAM; }
 
-template<std::ranges::random_access_range R>
-void inorder_impl(R dirs, std::vector<std::size_t>& result, std::size_t id) {
-  if (id == NOSTREAM)
-    return;
-  inorder_impl(dirs, result, dirs[id].left_id);
-  result.push_back(id);
-  inorder_impl(dirs, result, dirs[id].right_id);
-}
+/**
+ * Проверка графа каталога за O(n) с битовой картой посещённых записей. От корня явным стеком обходятся ссылки
+ * left_id, right_id и child_id, и каждая запись должна встретиться не больше одного раза: повторная встреча -
+ * это цикл или запись, на которую ссылаются дважды. Кроме того:
+ * - запись 0 - корень без соседей, каждая ссылка - NOSTREAM или номер существующей записи;
+ * - достижимые записи заняты (хранилище или поток), дети есть только у хранилищ и корня.
+ * Недостижимые записи не проверяются: ни поиск, ни обход до них не доходят.
+ */
+inline Error validate_directory(std::span<const DirectoryEntry> dirs) {
+  if (dirs.empty() || dirs.front().type != file_type::root || dirs.front().left_id != NOSTREAM ||
+      dirs.front().right_id != NOSTREAM) {
+    return Error::InvalidDirectoryTree;
+  }
 
-template<std::ranges::random_access_range R>
-std::vector<std::size_t> inorder(R dirs, std::size_t id) {
-  std::vector<std::size_t> result;
-  inorder_impl(dirs, result, id);
-  return result;
+  std::vector<bool> visited(dirs.size());
+  visited[0] = true;
+  std::vector<std::uint32_t> stack{dirs.front().child_id};
+  while (not stack.empty()) {
+    const auto id = stack.back();
+    stack.pop_back();
+    if (id == NOSTREAM) {
+      continue;
+    }
+    if (id >= dirs.size() || visited[id]) {
+      return Error::InvalidDirectoryTree;
+    }
+    visited[id] = true;
+
+    const auto& entry = dirs[id];
+    if (entry.type != file_type::directory && entry.type != file_type::regular) {
+      return Error::InvalidDirectoryTree;
+    }
+    if (entry.type == file_type::regular && entry.child_id != NOSTREAM) {
+      return Error::InvalidDirectoryTree;
+    }
+    stack.push_back(entry.left_id);
+    stack.push_back(entry.right_id);
+    stack.push_back(entry.child_id);
+  }
+  return Error::Success;
 }
 
+/**
+ * Записи одного каталога в порядке имён: in-order по left_id/right_id без рекурсии и без списка всех записей заранее.
+ * В стеке только левый спуск от текущей записи, O(глубины дерева), записи выдаются по мере обхода.
+ * На непроверенном каталоге обход безопасен: ссылка за пределы каталога считается NOSTREAM, а глубина стека и число
+ * выданных записей ограничены числом записей каталога, поэтому цикл обрывает обход, а не зацикливает его.
+ */
 class InorderDirectoryIterator {
 public:
   // Требования std::input_iterator
@@ -59,15 +101,24 @@ public:
   using value_type       = DirectoryEntry;
   using difference_type  = std::ptrdiff_t;
 
-  InorderDirectoryIterator(const std::vector<DirectoryEntry>& base, std::size_t root): base_(std::addressof(base)), q(inorder(base, root)) {}
+  InorderDirectoryIterator(std::span<const DirectoryEntry> base, std::size_t root): base_(base) {
+    descend(root);
+  }
 
   reference operator*() const { return dereference(); }
   const value_type* operator->() const { return std::addressof(dereference()); }
 
   InorderDirectoryIterator& operator++() {
-    if (q.empty()) return *this;
-
-    q.pop_back();
+    if (stack_.empty()) return *this;
+
+    const auto right = dereference().right_id;
+    stack_.pop_back();
+    if (++yielded_ == base_.size()) {
+      // все записи каталога уже выданы: дальше только цикл
+      stack_.clear();
+      return *this;
+    }
+    descend(right);
     return *this;
   }
 
@@ -77,17 +128,29 @@ public:
     return tmp;
   }
 
-  bool operator==([[maybe_unused]] std::default_sentinel_t unused) const { return q.empty(); }
+  bool operator==([[maybe_unused]] std::default_sentinel_t unused) const { return stack_.empty(); }
 
 private:
-  [[nodiscard]] reference dereference() const& { return (*base_)[q.back()]; }
+  [[nodiscard]] reference dereference() const& { return base_[stack_.back()]; }
+
+  // Левый спуск от id: следующая по порядку запись окажется на вершине стека
+  void descend(std::size_t id) {
+    while (id < base_.size()) {
+      if (stack_.size() == base_.size()) {
+        stack_.clear();
+        return;
+      }
+      stack_.push_back(static_cast<std::uint32_t>(id));
+      id = base_[id].left_id;
+    }
+  }
 
 private:
-  const std::vector<DirectoryEntry>* base_;
-  std::vector<std::size_t> q;
+  std::span<const DirectoryEntry> base_;
+  std::vector<std::uint32_t> stack_;
+  std::size_t yielded_ = 0;
 };
 
-
 template<std::ranges::viewable_range R>
 class TraversalDirectoryIterator {
 public:
@@ -136,15 +199,15 @@ private:
 class InorderDirectoryView final: public std::ranges::view_interface<InorderDirectoryView> {
 public:
   InorderDirectoryView() = default;
-  InorderDirectoryView(const std::vector<DirectoryEntry>& src, std::size_t root): base_(std::addressof(src)), root_(root) {}
-  [[nodiscard]] InorderDirectoryIterator begin() const { return {*base_, root_}; }
+  InorderDirectoryView(std::span<const DirectoryEntry> src, std::size_t root): base_(src), root_(root) {}
+  [[nodiscard]] InorderDirectoryIterator begin() const { return {base_, root_}; }
   [[nodiscard]] std::default_sentinel_t end() const { return {}; }
 private:
-  const std::vector<DirectoryEntry>* base_;
+  std::span<const DirectoryEntry> base_;
   std::size_t root_ = NOSTREAM;
 };
 
-auto dir_view(const std::vector<DirectoryEntry>& base, std::size_t root) {
+inline auto dir_view(std::span<const DirectoryEntry> base, std::size_t root) {
   return InorderDirectoryView(base, root);
 }
 
@@ -172,64 +235,126 @@ std::optional<std::ranges::range_value_t<R>> find(R base, String key, std::size_
   return *b;
 }
 
-/*
-template<std::ranges::viewable_range R>
-class DirectoryLevelIterator {
+// Запись рекурсивного обхода: путь от корня ("Storage/Stream") и сама запись
+struct RecursiveDirectoryEntry {
+  PathView<char16_t> path;
+  const DirectoryEntry& entry;
+};
+
+/**
+ * Обход всего контейнера в глубину, как std::filesystem::recursive_directory_iterator: хранилище выдаётся перед
+ * своим содержимым, записи одного уровня - в порядке имён. Дерево заранее не разворачивается: в памяти только
+ * InorderDirectoryIterator на каждый открытый уровень. Путь собирается в одном буфере итератора, поэтому
+ * RecursiveDirectoryEntry::path действителен до следующего ++.
+ * Как и у InorderDirectoryIterator, число выданных записей ограничено размером каталога: цикл через child_id
+ * в непроверенном каталоге обрывает обход.
+ */
+class RecursiveDirectoryIterator {
 public:
   // Требования std::input_iterator
-  using iterator_category = std::forward_iterator_tag;
-  using iterator_concept = std::forward_iterator_tag;
-  using reference = InorderDirectoryView<R>;
-  using value_type       = InorderDirectoryView<R>;
+  using iterator_category = std::input_iterator_tag;
+  using iterator_concept = std::input_iterator_tag;
+  using reference = RecursiveDirectoryEntry;
+  using value_type       = RecursiveDirectoryEntry;
   using difference_type  = std::ptrdiff_t;
 
-  DirectoryLevelIterator(R base, std::size_t root): base(base), root(root) {}
+  // Содержимое хранилища storage (по умолчанию корня), пути - относительно него
+  explicit RecursiveDirectoryIterator(std::span<const DirectoryEntry> base, std::size_t storage = 0)
+      : base_(base) {
+    if (storage < base.size()) {
+      levels_.push_back({InorderDirectoryIterator{base, base[storage].child_id}, 0});
+      settle();
+    }
+  }
 
-  reference operator*() const { return dir_view(base, root); }
+  reference operator*() const { return {PathView<char16_t>{path_}, *levels_.back().it}; }
 
-  DirectoryLevelIterator& operator++() {
-    auto dir = dir_view(base, root);
-    auto found = std::ranges::find_if(dir, has_children);
-    root = found == cend(dir) ? NOSTREAM : found->child_id;
+  // Глубина текущей записи: 0 у записей верхнего уровня
+  [[nodiscard]] std::size_t depth() const noexcept { return levels_.size() - 1; }
 
+  RecursiveDirectoryIterator& operator++() {
+    if (levels_.empty()) return *this;
+
+    const auto& entry = *levels_.back().it;
+    ++levels_.back().it;
+    if (++yielded_ == base_.size()) {
+      levels_.clear();
+      return *this;
+    }
+    // содержимое хранилища идёт сразу за ним, остальные записи его уровня - после
+    if (entry.type == file_type::directory && has_children(entry)) {
+      levels_.push_back({InorderDirectoryIterator{base_, entry.child_id}, path_.size()});
+    }
+    settle();
     return *this;
   }
 
-  DirectoryLevelIterator operator++(int) {
-    auto tmp = *this;
-    ++*this;
-    return tmp;
-  }
+  void operator++(int) { ++*this; }
+
+  bool operator==([[maybe_unused]] std::default_sentinel_t unused) const { return levels_.empty(); }
 
-  bool operator==([[maybe_unused]] std::default_sentinel_t unused) const { return root == NOSTREAM; }
 private:
-  R base;
-  std::size_t root = NOSTREAM;
-};
+  struct Level {
+    InorderDirectoryIterator it;
+    std::size_t prefix; // длина пути хранилища, в котором лежит уровень
+  };
+
+  // Закрывает исчерпанные уровни и дописывает в буфер имя следующей записи
+  void settle() {
+    while (not levels_.empty() && levels_.back().it == std::default_sentinel) {
+      levels_.pop_back();
+    }
+    if (levels_.empty()) {
+      return;
+    }
 
+    const auto& [it, prefix] = levels_.back();
+    path_.resize(prefix);
+    if (prefix != 0) {
+      path_.push_back(u'/');
+    }
+    path_.append(static_cast<std::u16string_view>(it->name));
+  }
 
-template<std::ranges::viewable_range R>
-class DirectoryLevelView: public std::ranges::view_interface<DirectoryLevelView<R>> {
 private:
-  using Base = R;
+  std::span<const DirectoryEntry> base_;
+  std::vector<Level> levels_;
+  std::u16string path_;
+  std::size_t yielded_ = 0;
+};
+
+class RecursiveDirectoryView final: public std::ranges::view_interface<RecursiveDirectoryView> {
 public:
-  DirectoryLevelView() = default;
-  DirectoryLevelView(R base, std::size_t root): base_(base), root_(root) {}
-  [[nodiscard]] DirectoryLevelIterator<R> begin() const { return DirectoryLevelIterator<R>(base_, root_); }
+  RecursiveDirectoryView() = default;
+  explicit RecursiveDirectoryView(std::span<const DirectoryEntry> src, std::size_t storage = 0)
+      : base_(src), storage_(storage) {}
+  [[nodiscard]] RecursiveDirectoryIterator begin() const { return RecursiveDirectoryIterator{base_, storage_}; }
   [[nodiscard]] std::default_sentinel_t end() const { return {}; }
 private:
-  Base base_;
-  std::size_t root_ = NOSTREAM;
+  std::span<const DirectoryEntry> base_;
+  std::size_t storage_ = 0;
 };
 
-template<std::ranges::viewable_range R>
-auto DirectoryLevels(R r, std::size_t root) {
-  return DirectoryLevelView<R>(std::move(r), root);
+// Сегмент пути как имя для сравнения с записями каталога; nullopt, если такого имени быть не может
+inline std::optional<String> segment_key(const String& segment) noexcept { return segment; }
+
+inline std::optional<String> segment_key(std::u16string_view segment) noexcept {
+  auto key = String::make(segment);
+  return key ? std::optional{*key} : std::nullopt;
+}
+
+inline std::optional<String> segment_key(std::string_view segment) noexcept {
+  auto key = String::from_utf8(segment);
+  return key ? std::optional{*key} : std::nullopt;
 }
-*/
+
 /**
  * Iterator that advances segment-by-segment, resolving each to an entry.
+ * Segments come from any path range (ole::Path, ole::PathView), each one is turned into a String on the stack.
+ * Как и InorderDirectoryIterator, безопасен на непроверенном каталоге: ссылка за пределы каталога считается NOSTREAM,
+ * а поиск сегмента делает не больше шагов, чем записей в каталоге, так что цикл даёт "не найдено".
  */
+template<std::input_iterator KeyIt>
 class PathResolveIterator {
 public:
   // Требования std::input_iterator
@@ -240,18 +365,24 @@ public:
   using difference_type  = std::ptrdiff_t;
 
   PathResolveIterator(
-    const std::vector<DirectoryEntry>& base,
-    std::vector<String>::const_iterator key,
-    std::size_t root): base_(std::addressof(base)), key_(key), root_(root) {
+    std::span<const DirectoryEntry> base,
+    KeyIt key,
+    KeyIt last,
+    std::size_t root): base_(base), key_(key), last_(last), root_(root) {
 
-    if (key_ == std::ranges::sentinel_t<Path> {}) {
+    const auto name = key_ == last_ ? std::nullopt : segment_key(*key_);
+    if (not name) {
       root_ = NOSTREAM;
     }
 
-    while (root_ != NOSTREAM) {
-      if (const auto& e = (*base_)[root_]; *key_ < e.name) {
+    for (std::size_t steps = 0; root_ != NOSTREAM; ++steps) {
+      if (root_ >= base_.size() || steps == base_.size()) {
+        root_ = NOSTREAM;
+        break;
+      }
+      if (const auto& e = base_[root_]; *name < e.name) {
         root_ = e.left_id;
-      } else if (*key_ > e.name) {
+      } else if (*name > e.name) {
         root_ = e.right_id;
       } else { break; }
     }
@@ -261,7 +392,7 @@ public:
   const value_type* operator->() const { return std::addressof(dereference()); }
 
   PathResolveIterator& operator++() {
-    *this = PathResolveIterator(*base_, next(key_), dereference().child_id);
+    *this = PathResolveIterator(base_, std::next(key_), last_, dereference().child_id);
     return *this;
   }
 
@@ -274,31 +405,37 @@ public:
   bool operator==([[maybe_unused]] std::default_sentinel_t unused) const { return root_ == NOSTREAM; }
 
 private:
-  [[nodiscard]] reference dereference() const& { return (*base_)[root_]; }
+  [[nodiscard]] reference dereference() const& { return base_[root_]; }
 
 private:
-  const std::vector<DirectoryEntry>* base_;
-  std::vector<String>::const_iterator  key_;
+  std::span<const DirectoryEntry> base_;
+  KeyIt key_;
+  KeyIt last_;
   std::size_t root_ = NOSTREAM;
 };
 
 /**
  * A view that resolves a path into the sequence of matched DirectoryEntries.
+ * The path is referenced, not copied: it must outlive the view.
  */
-class PathResolveView: public std::ranges::view_interface<PathResolveView> {
+template<std::ranges::forward_range P>
+class PathResolveView: public std::ranges::view_interface<PathResolveView<P>> {
 public:
   PathResolveView() = default;
-  PathResolveView(const std::vector<DirectoryEntry>& base, const ole::Path& target, std::size_t root): base_(std::addressof(base)), target_(std::addressof(target)), root_(root) {}
-  [[nodiscard]] PathResolveIterator begin() const { return {*base_, std::cbegin(*target_), root_}; }
+  PathResolveView(std::span<const DirectoryEntry> base, const P& target, std::size_t root): base_(base), target_(std::addressof(target)), root_(root) {}
+  [[nodiscard]] auto begin() const {
+    return PathResolveIterator<std::ranges::iterator_t<const P>>{base_, std::ranges::begin(*target_), std::ranges::end(*target_), root_};
+  }
   [[nodiscard]] std::default_sentinel_t end() const { return {}; }
 private:
-  const std::vector<DirectoryEntry>* base_;
-  const Path* target_;
+  std::span<const DirectoryEntry> base_;
+  const P* target_ = nullptr;
   std::size_t root_ = NOSTREAM;
 };
 
-auto PathResolve(const std::vector<DirectoryEntry>& src, const ole::Path& target, std::size_t root) {
-  return PathResolveView(src, target, root);
+template<std::ranges::forward_range P>
+auto PathResolve(std::span<const DirectoryEntry> src, const P& target, std::size_t root) {
+  return PathResolveView<P>(src, target, root);
 }
 
 } // namespace ole
\ No newline at end of file
@@ -23,6 +23,13 @@ enum class Error : std::uint8_t {
   Exceeds62Bytes = 16,
   Exceeds64Bytes = 17,
   NotMultipleOf2 = 18,
-  NotNullTerminated = 19
+  NotNullTerminated = 19,
+  NotAStream = 20,
+  InvalidFatEntry = 21,
+  FatCrossLinked = 22,
+  FatChainCycle = 23,
+  InvalidDirectoryTree = 24,
+  NotFound = 25,
+  BufferTooSmall = 26
 };
 } // namespace ole
\ No newline at end of file
@@ -0,0 +1,495 @@
+#pragma once
+
+#include "containerfs/cached_device.h"
+#include "containerfs/device_api.h"
+#include "ole.h"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Резидентные сектора метаданных (DIFAT, FAT, каталог, miniFAT): сектор читается с устройства при первом обращении,
+ * в памяти держится не больше capacity секторов, лишние вытесняются по CLOCK, как в CachedDevice.
+ * Сам по себе не потокобезопасен: LazyOleDriver обращается к нему только под своим мьютексом.
+ */
+class SectorPages final {
+public:
+  SectorPages(std::uint32_t sector_size, std::size_t capacity)
+      : sector_size_{sector_size}, capacity_{std::max<std::size_t>(capacity, 1)} {}
+
+  // Байты сектора sid или пустой span, если он не прочитался; действительны до следующего вызова get
+  template <typename Device>
+  std::span<const std::byte> get(Device &device, fat_t sid) {
+    if (const auto found = index_.find(sid); found != index_.end()) {
+      ++stats_.hits;
+      auto &page = pages_[found->second];
+      page.referenced = true;
+      return {page.data.get(), sector_size_};
+    }
+
+    ++stats_.misses;
+    auto data = std::make_unique_for_overwrite<std::byte[]>(sector_size_);
+    if (not device.read_at(sector_offset(sid, sector_size_), {data.get(), sector_size_})) {
+      return {};
+    }
+    return {insert(sid, std::move(data)), sector_size_};
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return pages_.size(); }
+  [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+  [[nodiscard]] containerfs::CacheStats stats() const noexcept { return stats_; }
+
+private:
+  struct Page {
+    fat_t sid = 0;
+    bool referenced = false;
+    std::unique_ptr<std::byte[]> data;
+  };
+
+  // CLOCK: стрелка пропускает страницы с битом обращения, сбрасывая его, и занимает первую без него
+  const std::byte *insert(fat_t sid, std::unique_ptr<std::byte[]> data) {
+    if (pages_.size() < capacity_) {
+      index_.emplace(sid, pages_.size());
+      return pages_.emplace_back(sid, false, std::move(data)).data.get();
+    }
+
+    for (;; hand_ = (hand_ + 1) % pages_.size()) {
+      auto &page = pages_[hand_];
+      if (page.referenced) {
+        page.referenced = false;
+        continue;
+      }
+      index_.erase(page.sid);
+      index_.emplace(sid, hand_);
+      page = {sid, false, std::move(data)};
+      hand_ = (hand_ + 1) % pages_.size();
+      return page.data.get();
+    }
+  }
+
+  std::uint32_t sector_size_;
+  std::size_t capacity_;
+  std::unordered_map<fat_t, std::size_t> index_; // номер сектора -> страница
+  std::vector<Page> pages_;
+  std::size_t hand_ = 0;
+  containerfs::CacheStats stats_;
+};
+
+/**
+ * Пройденная часть цепочки секторов: номер каждого stride-го сектора (контрольные точки) и последнего найденного.
+ * Сектор k ищется через next от ближайшей точки не дальше него, то есть не больше чем за stride шагов, а при
+ * последовательном проходе - за один. Точек не больше kMaxCheckpoints: когда их набирается столько, каждая вторая
+ * выбрасывается, а stride удваивается, так что память на цепочку ограничена при любой её длине.
+ */
+class ChainCheckpoints final {
+public:
+  static constexpr std::size_t kMaxCheckpoints = 1024;
+
+  // Сектор номер k цепочки, начинающейся с first; next(sid) - следующий за sid или ошибка
+  template <typename Next>
+  std::expected<fat_t, ole::Error> at(fat_t first, std::uint64_t k, Next next) {
+    if (checkpoints_.empty()) {
+      checkpoints_.push_back(first);
+      last_ = {0, first};
+    }
+
+    const auto point = std::min<std::uint64_t>(k / stride_, checkpoints_.size() - 1);
+    Position pos{point * stride_, checkpoints_[point]};
+    if (last_.index <= k && last_.index > pos.index) {
+      pos = last_;
+    }
+    while (pos.index < k) {
+      const auto sid = next(pos.sid);
+      if (not sid) {
+        return std::unexpected(sid.error());
+      }
+      pos = {pos.index + 1, *sid};
+      if (pos.index % stride_ == 0 && pos.index / stride_ == checkpoints_.size()) {
+        if (checkpoints_.size() == kMaxCheckpoints) {
+          thin();
+        }
+        checkpoints_.push_back(pos.sid);
+      }
+    }
+    last_ = pos;
+    return pos.sid;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return checkpoints_.size(); }
+  [[nodiscard]] std::uint64_t stride() const noexcept { return stride_; }
+
+private:
+  struct Position {
+    std::uint64_t index = 0;
+    fat_t sid = 0;
+  };
+
+  // Оставляет точки 0, 2, 4, ...: kMaxCheckpoints чётно, так что следующая точка попадает ровно в новый шаг
+  void thin() noexcept {
+    for (std::size_t i = 1; 2 * i < checkpoints_.size(); ++i) {
+      checkpoints_[i] = checkpoints_[2 * i];
+    }
+    checkpoints_.resize(checkpoints_.size() / 2);
+    stride_ *= 2;
+  }
+
+  std::vector<fat_t> checkpoints_;
+  std::uint64_t stride_ = 1;
+  Position last_;
+};
+
+/**
+ * Драйвер OLE с ленивым монтированием: для многогигабайтных файлов, из которых нужно прочитать пару потоков.
+ *
+ * create() читает только заголовок и первый сектор каталога (корневую запись), два чтения при любом размере файла.
+ * DIFAT, FAT, каталог и miniFAT читаются посекторно при первом обращении через SectorPages, в памяти держится
+ * не больше resident_sectors их секторов. Поиск пути спускается по красно-чёрным деревьям каталога от корня,
+ * трогая только записи на пути; индекса путей и индексов участков потоков, как у OleDriver, нет.
+ * Кроме секторов, в памяти остаются только контрольные точки цепочек DIFAT, каталога и miniFAT (ChainCheckpoints,
+ * не больше 4 КиБ на цепочку) и участки цепочки мини-потока.
+ *
+ * Чтения по пути - из OleStreamReads, как у OleDriver. Метаданные меняются и при чтении, поэтому все методы берут
+ * мьютекс драйвера, а чтения метаданных идут под ним. Данные потоков читаются без него, так что драйвер целиком
+ * потокобезопасен тогда и только тогда, когда Device удовлетворяет ConcurrentReadableDevice; иначе все вызовы
+ * нужно сериализовать снаружи.
+ */
+template <typename Device> class LazyOleDriver final : public OleStreamReads<LazyOleDriver<Device>> {
+public:
+  using error_type = ole::Error;
+
+  static constexpr std::size_t kDefaultResidentSectors = 256;
+
+  static std::expected<LazyOleDriver, error_type> create(Device &&dev,
+                                                         std::size_t resident_sectors = kDefaultResidentSectors) {
+    auto header = load_header(dev);
+    if (not header) {
+      return std::unexpected(header.error());
+    }
+
+    LazyOleDriver driver{std::move(dev), *header, resident_sectors};
+    auto root = driver.entry(0);
+    if (not root) {
+      return std::unexpected(root.error());
+    }
+    if (root->type != ole::file_type::root) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    driver.root_ = *root;
+    return driver;
+  }
+
+  template <ole::PathLike P>
+  [[nodiscard]] bool exists(const P &path) const noexcept { return lookup(path).has_value(); }
+
+  // Размер потока или -1, если это не поток или он не помещается в int, см. stream_file_size
+  template <ole::PathLike P>
+  int file_size(const P &path) const noexcept {
+    const auto entry = lookup(path);
+    return entry ? stream_file_size(*entry) : -1;
+  }
+
+  template <ole::PathLike P>
+  bool is_directory(const P &path) const noexcept {
+    const auto entry = lookup(path);
+    return entry && (entry->type == ole::file_type::directory || entry->type == ole::file_type::root);
+  }
+
+  // Сколько секторов метаданных сейчас в памяти и сколько из них было найдено без чтения устройства
+  [[nodiscard]] std::size_t resident_sectors() const {
+    std::lock_guard lock{state_->mutex};
+    return state_->pages.size();
+  }
+
+  [[nodiscard]] containerfs::CacheStats metadata_stats() const {
+    std::lock_guard lock{state_->mutex};
+    return state_->pages.stats();
+  }
+
+private:
+  friend class OleStreamReads<LazyOleDriver>;
+
+  // Всё, что меняется при обращениях; под одним мьютексом
+  struct State {
+    explicit State(SectorPages pages) : pages{std::move(pages)} {}
+
+    std::mutex mutex;
+    SectorPages pages;
+    ChainCheckpoints difat;
+    ChainCheckpoints directory;
+    ChainCheckpoints minifat;
+    std::optional<ExtentIndex> ministream; // цепочка корня, строится при первом чтении маленького потока
+  };
+
+  LazyOleDriver(Device &&dev, const OleHeader &header, std::size_t resident_sectors)
+      : dev_{std::move(dev)}, header_{header},
+        state_{std::make_unique<State>(SectorPages{sector_size(), resident_sectors})} {}
+
+  [[nodiscard]] std::uint32_t sector_size() const noexcept { return 1u << header_.sector_shift; }
+  [[nodiscard]] std::uint32_t fat_per_sector() const noexcept { return sector_size() / sizeof(fat_t); }
+
+  // Больше секторов, чем адресует FAT, ни в одной цепочке быть не может: это же и защита от циклов
+  [[nodiscard]] std::uint64_t max_sectors() const noexcept {
+    return std::uint64_t{header_.num_fat_sectors} * fat_per_sector();
+  }
+
+  // Запись номер index из сектора
+  static fat_t entry_at(std::span<const std::byte> sector, std::size_t index) noexcept {
+    fat_t value;
+    std::memcpy(&value, sector.data() + index * sizeof(fat_t), sizeof(value));
+    return value;
+  }
+
+  // Запись номер index из сектора sid (DIFAT, FAT или miniFAT)
+  std::expected<fat_t, ole::Error> load_entry(fat_t sid, std::size_t index) const {
+    if (is_reserved_sid(sid)) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    const auto sector = state_->pages.get(dev_, sid);
+    if (sector.empty()) {
+      return std::unexpected(ole::Error::IoFailure);
+    }
+    return entry_at(sector, index);
+  }
+
+  // Сектор номер k цепочки, начинающейся с first, через её контрольные точки. Цепочка длиннее limit испорчена
+  template <typename Next>
+  std::expected<fat_t, ole::Error> chain_at(ChainCheckpoints &chain, fat_t first, std::uint64_t k,
+                                            std::uint64_t limit, Next next) const {
+    if (k >= limit) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    const auto sid = chain.at(first, k, next);
+    if (sid && is_reserved_sid(*sid)) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    return sid;
+  }
+
+  // Номер FAT-сектора k: первые 109 - в заголовке, остальные - в цепочке DIFAT
+  std::expected<fat_t, ole::Error> fat_sector(std::uint64_t k) const {
+    if (k >= header_.num_fat_sectors) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    if (k < header_.difat.size()) {
+      return header_.difat[k];
+    }
+
+    // последняя запись DIFAT-сектора - номер следующего DIFAT-сектора
+    const auto per_difat = fat_per_sector() - 1;
+    const auto rest = k - header_.difat.size();
+    const auto difat = chain_at(state_->difat, header_.first_difat_sector, rest / per_difat, header_.num_difat_sectors,
+                                [&](fat_t sid) { return load_entry(sid, per_difat); });
+    if (not difat) {
+      return std::unexpected(difat.error());
+    }
+    return load_entry(*difat, rest % per_difat);
+  }
+
+  // Следующий сектор за sid по FAT
+  std::expected<fat_t, ole::Error> next_sector(fat_t sid) const {
+    const auto sector = fat_sector(sid / fat_per_sector());
+    if (not sector) {
+      return std::unexpected(sector.error());
+    }
+    return load_entry(*sector, sid % fat_per_sector());
+  }
+
+  // Следующий мини-сектор за sid по miniFAT
+  std::expected<fat_t, ole::Error> next_mini_sector(fat_t sid) const {
+    const auto sector = chain_at(state_->minifat, header_.first_mini_fat_sector, sid / fat_per_sector(),
+                                 header_.num_mini_fat_sectors, [this](fat_t s) { return next_sector(s); });
+    if (not sector) {
+      return std::unexpected(sector.error());
+    }
+    return load_entry(*sector, sid % fat_per_sector());
+  }
+
+  // Запись каталога id: сектор каталога ищется по его цепочке, запись разбирается прямо из сектора
+  std::expected<ole::DirectoryEntry, ole::Error> entry(std::uint32_t id) const {
+    const auto per_sector = sector_size() / sizeof(DirectoryEntryRaw);
+    // в версии 3 число секторов каталога в заголовке не хранится
+    const auto limit = header_.num_dir_sectors != 0 ? header_.num_dir_sectors : max_sectors();
+    const auto sid = chain_at(state_->directory, header_.first_dir_sector, id / per_sector, limit,
+                              [this](fat_t s) { return next_sector(s); });
+    if (not sid) {
+      return std::unexpected(sid.error());
+    }
+    const auto sector = state_->pages.get(dev_, *sid);
+    if (sector.empty()) {
+      return std::unexpected(ole::Error::IoFailure);
+    }
+    const auto bytes = sector.subspan((id % per_sector) * sizeof(DirectoryEntryRaw)).template first<sizeof(DirectoryEntryRaw)>();
+    return decode_directory_entry(bytes, header_);
+  }
+
+  // Цепочка от first целиком в виде участков; limit - сколько в ней может быть секторов
+  template <typename Next>
+  std::expected<std::vector<Extent>, ole::Error> extents(fat_t first, std::uint64_t limit, Next next) const {
+    std::vector<Extent> result;
+    std::uint64_t count = 0;
+    for (auto sid = first; sid != ENDOFCHAIN;) {
+      if (is_reserved_sid(sid) || ++count > limit) {
+        return std::unexpected(ole::Error::CorruptedFile);
+      }
+      if (not result.empty() && result.back().first + result.back().count == sid) {
+        ++result.back().count;
+      } else {
+        result.push_back({sid, 1});
+      }
+      const auto following = next(sid);
+      if (not following) {
+        return std::unexpected(following.error());
+      }
+      sid = *following;
+    }
+    return result;
+  }
+
+  // Сегмент пути как имя записи каталога
+  template <typename S>
+  static std::optional<ole::String> key(const S &segment) noexcept {
+    if constexpr (std::same_as<S, std::filesystem::path>) {
+      return ole::segment_key(std::basic_string_view{segment.native()});
+    } else {
+      return ole::segment_key(segment);
+    }
+  }
+
+  template <typename P>
+  std::optional<ole::DirectoryEntry> find(const P &path) const {
+    std::lock_guard lock{state_->mutex};
+    return find_locked(path);
+  }
+
+  /**
+   * find для exists/file_size/is_directory, которые у FileSystem noexcept: мьютекс, аллокации и само устройство
+   * могут бросить, и такой путь считается ненайденным, как и при ошибке чтения метаданных.
+   */
+  template <typename P>
+  std::optional<ole::DirectoryEntry> lookup(const P &path) const noexcept {
+    try {
+      return find(path);
+    } catch (...) {
+      return std::nullopt;
+    }
+  }
+
+  // Спуск по деревьям каталога от корня; каждая запись на пути читается через SectorPages
+  template <typename P>
+  std::optional<ole::DirectoryEntry> find_locked(const P &path) const {
+    const auto max_entries = max_sectors() * (sector_size() / sizeof(DirectoryEntryRaw));
+    std::uint64_t steps = 0;
+    std::optional<ole::DirectoryEntry> found;
+    auto id = root_.child_id;
+    for (const auto &segment : path) {
+      const auto name = key(segment);
+      if (not name || name->size_bytes() == 0) {
+        return std::nullopt;
+      }
+
+      found.reset();
+      while (not found) {
+        if (id == ole::NOSTREAM || ++steps > max_entries) {
+          return std::nullopt;
+        }
+        auto candidate = entry(id);
+        if (not candidate) {
+          return std::nullopt;
+        }
+        if (*name < candidate->name) {
+          id = candidate->left_id;
+        } else if (*name > candidate->name) {
+          id = candidate->right_id;
+        } else {
+          found = *candidate;
+        }
+      }
+      id = found->child_id;
+    }
+    return found;
+  }
+
+  // Путь -> запросы для OleStreamReads: метаданные ищутся под мьютексом, сами запросы выполняются уже без него
+  template <typename Target>
+  std::expected<std::size_t, error_type> plan_stream(const std::filesystem::path &path, std::uint64_t offset,
+                                                     Target target, std::vector<containerfs::ReadRequest> &requests) const {
+    std::lock_guard lock{state_->mutex};
+    const auto entry = find_locked(path);
+    if (not entry || entry->type != ole::file_type::regular) {
+      return std::unexpected(ole::Error::NotAStream);
+    }
+    // размер проверяем до аллокации в target: stream_size из файла может быть любым
+    std::optional<ExtentIndex> index;
+    if (entry->stream_size != 0) {
+      index = stream_index(*entry);
+      if (not index || index->size() < entry->stream_size) {
+        return std::unexpected(ole::Error::CorruptedFile);
+      }
+    }
+
+    offset = std::min(offset, entry->stream_size);
+    const auto dst = target(entry->stream_size - offset);
+    if (not dst) {
+      return std::unexpected(dst.error());
+    }
+    if (not dst->empty() && not plan_range(*entry, *index, offset, *dst, requests)) {
+      return std::unexpected(ole::Error::CorruptedFile);
+    }
+    return dst->size();
+  }
+
+  // Индекс участков потока: по FAT для обычных потоков, по miniFAT (в мини-секторах) для маленьких
+  [[nodiscard]] std::optional<ExtentIndex> stream_index(const ole::DirectoryEntry &entry) const {
+    if (entry.stream_size >= header_.mini_stream_cutoff_size) {
+      const auto chain = extents(entry.starting_sector, max_sectors(), [this](fat_t s) { return next_sector(s); });
+      return chain ? std::optional{ExtentIndex{*chain, sector_size()}} : std::nullopt;
+    }
+    const auto chain = extents(entry.starting_sector, std::uint64_t{header_.num_mini_fat_sectors} * fat_per_sector(),
+                               [this](fat_t s) { return next_mini_sector(s); });
+    return chain ? std::optional{ExtentIndex{*chain, std::uint32_t{1} << header_.mini_sector_shift}} : std::nullopt;
+  }
+
+  /**
+   * Запросы на чтение байт [pos, pos + dst.size()) потока entry по его индексу. Участки маленького потока
+   * переводятся в смещения мини-потока, а те - в чтения цепочки корня.
+   */
+  bool plan_range(const ole::DirectoryEntry &entry, const ExtentIndex &index, std::uint64_t pos,
+                  std::span<std::byte> dst, std::vector<containerfs::ReadRequest> &requests) const {
+    if (entry.stream_size >= header_.mini_stream_cutoff_size) {
+      return index.append_requests(pos, dst, requests);
+    }
+
+    auto &ministream = state_->ministream;
+    if (not ministream) {
+      const auto chain = extents(root_.starting_sector, max_sectors(), [this](fat_t s) { return next_sector(s); });
+      if (not chain) {
+        return false;
+      }
+      ministream.emplace(*chain, sector_size());
+    }
+
+    if (dst.size() > index.size() || pos > index.size() - dst.size()) {
+      return false;
+    }
+    const auto mini_sector_size = std::uint64_t{index.unit_size()};
+    for (auto it = index.locate(pos); not dst.empty(); ++it) {
+      const auto skip = pos - it->offset;
+      const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(it->count * mini_sector_size - skip, dst.size()));
+      const auto from = it->first * mini_sector_size + skip;
+      if (from > root_.stream_size || size > root_.stream_size - from ||
+          not ministream->append_requests(from, dst.first(size), requests)) {
+        return false;
+      }
+      dst = dst.subspan(size);
+      pos += size;
+    }
+    return true;
+  }
+
+  mutable Device dev_;
+  OleHeader header_ {};
+  ole::DirectoryEntry root_ {};
+  std::unique_ptr<State> state_;
+};
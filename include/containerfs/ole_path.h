@@ -4,7 +4,10 @@
 
 #include "ole_string.h"
 
+#include <concepts>
+#include <iterator>
 #include <ostream>
+#include <string_view>
 #include <vector>
 
 namespace ole {
@@ -30,6 +33,100 @@ private:
   std::vector<String> paths_;
 };
 
+/**
+ * Невладеющий путь для поиска: строка режется по '/' лениво, по сегменту на шаг итератора, ничего не копируется
+ * и не проверяется заранее. Сегменты - string_view в исходную строку (UTF-16 или UTF-8 для std::filesystem::path),
+ * пустые сегменты ("a//b", "/a", "a/") сохраняются: имени "" в OLE нет, поэтому такой путь ничего не найдёт.
+ * Исходная строка должна жить дольше представления.
+ */
+template <typename CharT = char16_t>
+class PathView final {
+public:
+  using string_view = std::basic_string_view<CharT>;
+
+  class iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using iterator_concept = std::bidirectional_iterator_tag;
+    using value_type = string_view;
+    using reference = string_view;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+
+    reference operator*() const noexcept { return path_.substr(pos_, size_); }
+
+    iterator& operator++() noexcept {
+      pos_ += size_ + 1;
+      size_ = pos_ > path_.size() ? 0 : segment_end(pos_) - pos_;
+      return *this;
+    }
+
+    iterator operator++(int) noexcept {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    iterator& operator--() noexcept {
+      // предыдущий сегмент кончается на разделителе перед текущим (или на конце строки для end())
+      const auto end = pos_ - 1;
+      const auto slash = end == 0 ? string_view::npos : path_.rfind(CharT{'/'}, end - 1);
+      pos_ = slash == string_view::npos ? 0 : slash + 1;
+      size_ = end - pos_;
+      return *this;
+    }
+
+    iterator operator--(int) noexcept {
+      auto tmp = *this;
+      --*this;
+      return tmp;
+    }
+
+    bool operator==(const iterator& other) const noexcept { return pos_ == other.pos_; }
+
+  private:
+    friend class PathView;
+
+    iterator(string_view path, std::size_t pos) noexcept
+        : path_{path}, pos_{pos}, size_{pos > path.size() ? 0 : segment_end(pos) - pos} {}
+
+    [[nodiscard]] std::size_t segment_end(std::size_t pos) const noexcept {
+      return std::min(path_.find(CharT{'/'}, pos), path_.size());
+    }
+
+    string_view path_;
+    std::size_t pos_ = 0; // начало сегмента; path_.size() + 1 у end()
+    std::size_t size_ = 0;
+  };
+
+  PathView() = default;
+  constexpr PathView(string_view path) noexcept : path_{path} {}
+  constexpr PathView(const CharT* path) noexcept : path_{path} {}
+  // сегменты std::filesystem::path в родной кодировке (UTF-8 в POSIX)
+  PathView(const std::filesystem::path& path) noexcept requires std::same_as<CharT, std::filesystem::path::value_type>
+      : path_{path.native()} {}
+
+  [[nodiscard]] iterator begin() const noexcept { return {path_, path_.empty() ? path_.size() + 1 : 0}; }
+  [[nodiscard]] iterator end() const noexcept { return {path_, path_.size() + 1}; }
+  [[nodiscard]] bool empty() const noexcept { return path_.empty(); }
+  [[nodiscard]] string_view str() const noexcept { return path_; }
+
+private:
+  string_view path_;
+};
+
+PathView(std::u16string_view) -> PathView<char16_t>;
+PathView(const char16_t*) -> PathView<char16_t>;
+PathView(std::string_view) -> PathView<char>;
+PathView(const char*) -> PathView<char>;
+PathView(const std::filesystem::path&) -> PathView<std::filesystem::path::value_type>;
+
+// Пути, которые понимают поиск по каталогу: владеющий Path, std::filesystem::path и PathView
+template <typename P>
+concept PathLike = std::same_as<P, Path> || std::same_as<P, std::filesystem::path> ||
+                   std::same_as<P, PathView<char16_t>> || std::same_as<P, PathView<std::filesystem::path::value_type>>;
+
 inline std::ostream& operator<<(std::ostream &os, const Path &path) {
   for (const auto &p : path) {
     os << std::filesystem::path(static_cast<std::u16string_view>(p));
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "ole_directory.h"
+#include "ole_path.h"
+#include "ole_string.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ole {
+
+/**
+ * Индекс полных путей: нормализованный путь -> id записи каталога, строится один раз при монтировании.
+ *
+ * Ключ - свёрнутые имена (String::folded, как в String::compare) через разделитель.
+ * Поиск не аллоцирует: сегменты пути (ole::Path, ole::PathView или std::filesystem::path в UTF-8) по одному
+ * превращаются в String на стеке, хешируются, дальше одна проба открытой адресации и сверка имён вверх по цепочке
+ * родителей.
+ *
+ * Таблица и временные списки обхода берутся из resource: драйвер строит индекс в арене монтирования.
+ */
+class PathIndex final {
+public:
+  PathIndex() = default;
+
+  // Обходит дерево каталога от корня; записи с некорректными ссылками и повторно встреченные пропускаются
+  explicit PathIndex(std::span<const DirectoryEntry> dirs,
+                     std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : slots_{resource}, parent_{resource}, depth_{resource} {
+    if (dirs.empty()) {
+      return;
+    }
+
+    parent_.assign(dirs.size(), NOSTREAM);
+    depth_.assign(dirs.size(), 0);
+    std::pmr::vector<bool> visited(dirs.size(), false, resource);
+    std::pmr::vector<std::uint32_t> ids{resource};
+    std::pmr::vector<std::uint64_t> hashes{resource};
+
+    struct Pending {
+      std::uint32_t id;
+      std::uint32_t parent;
+      std::uint64_t parent_hash;
+      std::uint16_t depth;
+    };
+    std::pmr::vector<Pending> stack{{{dirs.front().child_id, 0, kHashBasis, 1}}, resource};
+    visited[0] = true;
+    while (not stack.empty()) {
+      const auto [id, parent, parent_hash, depth] = stack.back();
+      stack.pop_back();
+      if (id >= dirs.size() || visited[id]) {
+        continue;
+      }
+      visited[id] = true;
+
+      const auto &entry = dirs[id];
+      parent_[id] = parent == 0 ? NOSTREAM : parent;
+      depth_[id] = depth;
+      const auto hash = append(parent_hash, entry.name);
+      if (entry.name.size_bytes() != 0) {
+        hashes.push_back(hash);
+        ids.push_back(id);
+      }
+
+      // соседи по красно-чёрному дереву - в том же каталоге, дети - уровнем ниже
+      stack.push_back({entry.left_id, parent, parent_hash, depth});
+      stack.push_back({entry.right_id, parent, parent_hash, depth});
+      if (depth < kMaxDepth) {
+        stack.push_back({entry.child_id, id, hash, static_cast<std::uint16_t>(depth + 1)});
+      }
+    }
+
+    // открытая адресация с линейным пробированием, заполнение не больше половины
+    slots_.assign(std::bit_ceil(std::max<std::size_t>(ids.size() * 2, 2)), Slot{});
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+      for (auto pos = hashes[i] & mask(); ; pos = (pos + 1) & mask()) {
+        if (slots_[pos].id == NOSTREAM) {
+          slots_[pos] = {hashes[i], ids[i]};
+          break;
+        }
+      }
+    }
+  }
+
+  // id записи по пути или NOSTREAM
+  [[nodiscard]] std::uint32_t find(std::span<const DirectoryEntry> dirs, const Path &path) const noexcept {
+    return find_segments(dirs, path, [](const String &segment) { return segment.size_bytes() != 0 ? std::optional{segment} : std::nullopt; });
+  }
+
+  [[nodiscard]] std::uint32_t find(std::span<const DirectoryEntry> dirs, const std::filesystem::path &path) const noexcept {
+    return find_segments(dirs, path, [](const std::filesystem::path &segment) { return normalize(segment.native()); });
+  }
+
+  template <typename CharT>
+  [[nodiscard]] std::uint32_t find(std::span<const DirectoryEntry> dirs, const PathView<CharT> &path) const noexcept {
+    return find_segments(dirs, path, [](std::basic_string_view<CharT> segment) { return normalize(segment); });
+  }
+
+private:
+  struct Slot {
+    std::uint64_t hash = 0;
+    std::uint32_t id = NOSTREAM;
+  };
+
+  static constexpr std::uint64_t kHashBasis = 0xcbf29ce484222325ull; // FNV-1a
+  static constexpr std::uint64_t kHashPrime = 0x100000001b3ull;
+  static constexpr std::uint16_t kMaxDepth = 0xFFFF;
+
+  [[nodiscard]] std::size_t mask() const noexcept { return slots_.size() - 1; }
+
+  // Хеш пути продолжает хеш родителя: разделитель, затем свёрнутые code units имени
+  static std::uint64_t append(std::uint64_t hash, const String &name) noexcept {
+    hash = (hash ^ u'/') * kHashPrime;
+    for (const auto unit : name.folded()) {
+      hash = (hash ^ unit) * kHashPrime;
+    }
+    return hash;
+  }
+
+  // nullopt, если такого имени в OLE быть не может (пустое, длинное, с запрещёнными символами)
+  static std::optional<String> normalize(std::u16string_view src) noexcept {
+    auto name = String::make(src);
+    return name && not src.empty() ? std::optional{*name} : std::nullopt;
+  }
+
+  static std::optional<String> normalize(std::string_view src) noexcept {
+    auto name = String::from_utf8(src);
+    return name && not src.empty() ? std::optional{*name} : std::nullopt;
+  }
+
+  template <std::ranges::bidirectional_range R, typename Normalize>
+  [[nodiscard]] std::uint32_t find_segments(std::span<const DirectoryEntry> dirs, const R &path,
+                                            Normalize normalize_segment) const noexcept {
+    if (slots_.empty()) {
+      return NOSTREAM;
+    }
+
+    auto hash = kHashBasis;
+    std::size_t depth = 0;
+    for (const auto &segment : path) {
+      const auto name = normalize_segment(segment);
+      if (not name) {
+        return NOSTREAM;
+      }
+      hash = append(hash, *name);
+      ++depth;
+    }
+
+    for (auto pos = hash & mask(); slots_[pos].id != NOSTREAM; pos = (pos + 1) & mask()) {
+      const auto &[slot_hash, id] = slots_[pos];
+      if (slot_hash == hash && depth_[id] == depth && matches(dirs, path, id, normalize_segment)) {
+        return id;
+      }
+    }
+    return NOSTREAM;
+  }
+
+  // Сверка сегментов с конца с именами вверх по цепочке родителей
+  template <std::ranges::bidirectional_range R, typename Normalize>
+  [[nodiscard]] bool matches(std::span<const DirectoryEntry> dirs, const R &path, std::uint32_t id,
+                             Normalize normalize_segment) const noexcept {
+    for (auto it = std::ranges::end(path); it != std::ranges::begin(path); id = parent_[id]) {
+      --it;
+      if (id == NOSTREAM || normalize_segment(*it) != dirs[id].name) {
+        return false;
+      }
+    }
+    return id == NOSTREAM;
+  }
+
+  std::pmr::vector<Slot> slots_;
+  std::pmr::vector<std::uint32_t> parent_; // NOSTREAM у записей верхнего уровня
+  std::pmr::vector<std::uint16_t> depth_;
+};
+
+} // namespace ole
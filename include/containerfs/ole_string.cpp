@@ -34,10 +34,49 @@ std::expected<ole::String, ole::Error> ole::String::make(std::u16string_view src
 }
 
 std::expected<ole::String, ole::Error> ole::String::make(std::filesystem::path src) {
-  if (auto error = is_invalid(src.u16string()); error.has_value())
+  const auto name = src.u16string();
+  if (auto error = is_invalid(name); error.has_value())
     return std::unexpected(*error);
 
-  return ole::String(src.u16string());
+  return ole::String(std::u16string_view{name});
+}
+
+std::expected<ole::String, ole::Error> ole::String::from_utf8(std::string_view src) {
+  // декодируем в буфер на стеке по одному code point; длиннее kUnits - 1 всё равно нельзя
+  std::array<char16_t, kUnits> units{};
+  std::size_t size = 0;
+  const auto push = [&](char32_t unit) {
+    if (size == units.size()) {
+      return false;
+    }
+    units[size++] = static_cast<char16_t>(unit);
+    return true;
+  };
+
+  for (std::size_t i = 0; i < src.size();) {
+    const auto lead = static_cast<unsigned char>(src[i]);
+    const std::size_t length = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+    if (length == 0 || i + length > src.size()) {
+      return std::unexpected(Error::ContainsIllegalCharacters);
+    }
+    char32_t cp = length == 1 ? lead : lead & (0x7F >> length);
+    for (std::size_t k = 1; k < length; ++k) {
+      const auto cont = static_cast<unsigned char>(src[i + k]);
+      if ((cont & 0xC0) != 0x80) {
+        return std::unexpected(Error::ContainsIllegalCharacters);
+      }
+      cp = (cp << 6) | (cont & 0x3F);
+    }
+    i += length;
+
+    const auto fits = cp >= 0x10000 ? push(0xD800 + ((cp - 0x10000) >> 10)) && push(0xDC00 + ((cp - 0x10000) & 0x3FF))
+                                    : push(cp);
+    if (not fits) {
+      return std::unexpected(Error::Exceeds62Bytes);
+    }
+  }
+
+  return make(std::u16string_view{units.data(), size});
 }
 
 std::expected<ole::String, ole::Error> ole::String::make(std::array<std::byte, kBytes> raw, std::size_t size_in_bytes) {
@@ -51,62 +90,32 @@ std::expected<ole::String, ole::Error> ole::String::make(std::array<std::byte, k
     return std::unexpected{Error::NotMultipleOf2};
   }
 
-  std::u16string result(raw.size() / sizeof(char16_t), u'\0');
-  auto view = as_writable_bytes(std::span(result));
-  std::ranges::move(raw, view.begin());
-  result.resize(size_in_bytes / 2);
+  std::array<char16_t, kUnits> units{};
+  std::ranges::copy(raw, as_writable_bytes(std::span(units)).begin());
+  const auto result = std::u16string_view{units.data(), size_in_bytes / 2};
 
   if (result.back() != u'\0') {
     return std::unexpected{Error::NotNullTerminated};
   }
 
-  result.pop_back(); // мы не храним u'\0'
+  const auto name = result.substr(0, result.size() - 1); // мы не храним u'\0'
 
-  if (auto error = is_invalid(result); error.has_value())
+  if (auto error = is_invalid(name); error.has_value())
     return std::unexpected(*error);
 
-  return String(std::move(result));
+  return String(name);
 }
 
-std::strong_ordering ole::operator<=>(String const& a, String const& b) noexcept { return a.compare(b); }
-
-std::strong_ordering ole::String::compare(const String &other) const noexcept {
-  using std::strong_ordering;
-
-  // 1) Короче имя — меньше
-  if (s_.size() != other.s_.size()) {
-    return (s_.size() < other.s_.size()) ? strong_ordering::less
-                                         : strong_ordering::greater;
+ole::String::String(std::u16string_view src) noexcept : size_(static_cast<std::uint8_t>(std::min(src.size(), kUnits - 1))) {
+  // Simple case conversion (ASCII; суррогаты и не-ASCII не трогаем)
+  for (std::size_t i = 0; i < size_; ++i) {
+    const auto ch = src[i];
+    s_[i] = ch;
+    folded_[i] = ch >= u'a' && ch <= u'z' ? static_cast<char16_t>(ch - (u'a' - u'A')) : ch;
   }
-
-  // 2) Равная длина: поэлементно сравниваем code units после uppercasing
-  constexpr auto is_surrogate = [](char16_t ch) noexcept {
-    return ch >= 0xD800 && ch <= 0xDFFF;
-  };
-
-  // Simple case conversion (ASCII; не трогаем суррогаты и не-ASCII)
-  auto to_upper_simple = [&](char16_t ch) noexcept -> char16_t {
-    if (is_surrogate(ch)) return ch;               // суррогаты не uppercased
-    if (ch >= u'a' && ch <= u'z') return ch - (u'a' - u'A'); // ASCII
-    return ch;
-  };
-
-  for (std::size_t i = 0; i < s_.size(); ++i) {
-    const char16_t a = to_upper_simple(s_[i]);
-    const char16_t b = to_upper_simple(other.s_[i]);
-    if (a != b) {
-      return (a < b) ? strong_ordering::less : strong_ordering::greater;
-    }
-  }
-
-  return strong_ordering::equal;
 }
 
 std::uint16_t ole::String::size_bytes() const noexcept {
   // длина в байтах включая завершающий ноль
-  return static_cast<std::uint16_t>(s_.size() * sizeof(char16_t));
+  return static_cast<std::uint16_t>(size_ * sizeof(char16_t));
 }
-
-std::strong_ordering ole::compare(String const& a, String const& b) noexcept {
-  return a.compare(b);
-}
\ No newline at end of file
@@ -1,12 +1,46 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <compare>
 #include <expected>
 #include <filesystem>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "ole_error.h"
 
 namespace ole {
+namespace detail {
+// Индекс первого различающегося code unit в двух блоках по 32 или 32, если блоки равны
+inline std::size_t first_mismatch(const std::array<char16_t, 32> &a, const std::array<char16_t, 32> &b) noexcept {
+#if defined(__AVX2__)
+  for (std::size_t i = 0; i < a.size(); i += 16) {
+    const auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.data() + i));
+    const auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.data() + i));
+    if (const auto diff = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(va, vb))); diff != 0) {
+      return i + std::countr_zero(diff) / 2;
+    }
+  }
+  return a.size();
+#elif defined(__SSE2__)
+  for (std::size_t i = 0; i < a.size(); i += 8) {
+    const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data() + i));
+    const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data() + i));
+    if (const auto diff = ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(va, vb))) & 0xFFFF; diff != 0) {
+      return i + std::countr_zero(diff) / 2;
+    }
+  }
+  return a.size();
+#else
+  return static_cast<std::size_t>(std::ranges::mismatch(a, b).in1 - a.begin());
+#endif
+}
+} // namespace detail
+
 class String final {
 public:
   static constexpr std::size_t kBytes = 64;
@@ -17,19 +51,43 @@ public:
   static std::expected<String, Error> make(std::u16string_view src);
   static std::expected<String, Error> make(std::filesystem::path src);
   static std::expected<String, Error> make(std::array<std::byte, kBytes> raw, std::size_t size);
+  // Имя из UTF-8 (например, из сегмента std::filesystem::path), без промежуточной строки
+  static std::expected<String, Error> from_utf8(std::string_view src);
 
   [[nodiscard]] std::uint16_t size_bytes() const noexcept;
-  [[nodiscard]] std::strong_ordering compare(const String &other) const noexcept;
-  friend std::strong_ordering operator<=>(String const& a, String const& b) noexcept;
+
+  /**
+   * Порядок имён OLE: сначала длина, потом code units после uppercasing (simple case conversion, только ASCII).
+   * Обе стороны уже свёрнуты при создании, поэтому сравнение - это длина и одно блочное сравнение 32 code units.
+   */
+  [[nodiscard]] std::strong_ordering compare(const String &other) const noexcept {
+    if (size_ != other.size_) {
+      return size_ <=> other.size_;
+    }
+    const auto i = detail::first_mismatch(folded_, other.folded_);
+    return i == folded_.size() ? std::strong_ordering::equal : folded_[i] <=> other.folded_[i];
+  }
+
+  friend std::strong_ordering operator<=>(String const& a, String const& b) noexcept { return a.compare(b); }
   bool operator==(const String & other) const noexcept { return this->compare(other) == 0; }
-  operator std::u16string_view() const noexcept { return s_; }
+  operator std::u16string_view() const noexcept { return {s_.data(), size_}; }
+
+  // Имя в верхнем регистре, по которому идёт сравнение
+  [[nodiscard]] std::u16string_view folded() const noexcept { return {folded_.data(), size_}; }
 
 private:
-  explicit String(std::u16string_view src) : s_(src) {}
-  explicit String(std::u16string src) : s_(std::move(src)) {}
-  std::u16string s_;
+  // src уже проверено is_invalid: не длиннее kUnits - 1
+  explicit String(std::u16string_view src) noexcept;
+
+  /**
+   * Имя OLE не длиннее 31 code unit, поэтому хранится прямо в объекте, без кучи:
+   * запись каталога и сегмент пути копируются без аллокаций.
+   */
+  std::array<char16_t, kUnits> s_{};
+  // Свёрнутое имя, дополненное нулями до kUnits: хвост блоков у имён равной длины совпадает
+  std::array<char16_t, kUnits> folded_{};
+  std::uint8_t size_ = 0;
 };
 
-std::strong_ordering operator<=>(String const& a, String const& b) noexcept;
-std::strong_ordering compare(String const& a, String const& b) noexcept;
+inline std::strong_ordering compare(String const& a, String const& b) noexcept { return a.compare(b); }
 } // namespace ole
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "device_api.h"
+#include "namespace.h"
+
+#include <array>
+#include <cerrno>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+CONTAINERFS_NAMESPACE_BEGIN
+
+/**
+ * Устройство поверх файлового дескриптора, только чтение.
+ *
+ * read_at построен на pread(2), который не трогает общую позицию файла, поэтому он const и его можно вызывать
+ * из любого числа потоков одновременно (ConcurrentReadableDevice). read_many отправляет каждую серию соседних
+ * на диске запросов одним preadv(2), prefetch - posix_fadvise(WILLNEED). Если файл не открылся, любое чтение неудачно.
+ */
+class PosixFileDevice final {
+public:
+  explicit PosixFileDevice(const std::filesystem::path& path): fd_{::open(path.c_str(), O_RDONLY | O_CLOEXEC)} {}
+
+  PosixFileDevice(const PosixFileDevice&) = delete;
+  PosixFileDevice& operator=(const PosixFileDevice&) = delete;
+
+  PosixFileDevice(PosixFileDevice&& other) noexcept: fd_{std::exchange(other.fd_, -1)} {}
+
+  PosixFileDevice& operator=(PosixFileDevice&& other) noexcept {
+    if (this != &other) {
+      close();
+      fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+  }
+
+  ~PosixFileDevice() { close(); }
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) const noexcept {
+    // pread может вернуть меньше запрошенного: дочитываем, пока не заполним dst
+    while (not dst.empty()) {
+      const auto n = ::pread(fd_, dst.data(), dst.size(), static_cast<off_t>(off));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      dst = dst.subspan(static_cast<std::size_t>(n));
+      off += static_cast<std::uint64_t>(n);
+    }
+    return true;
+  }
+
+  bool read_many(std::span<const ReadRequest> requests) const noexcept {
+    std::array<iovec, kMaxIov> iov{};
+    while (not requests.empty()) {
+      // собираем подряд идущие на диске запросы в один preadv, память может быть разрывной
+      const auto offset = requests.front().offset;
+      auto end = offset;
+      std::size_t n = 0;
+      for (; n < requests.size() && n < iov.size() && requests[n].offset == end; ++n) {
+        iov[n] = {requests[n].dst.data(), requests[n].dst.size()};
+        end += requests[n].dst.size();
+      }
+
+      if (not preadv_all(offset, std::span{iov}.first(n))) {
+        return false;
+      }
+      requests = requests.subspan(n);
+    }
+    return true;
+  }
+
+  void prefetch(std::uint64_t off, std::uint64_t size) const noexcept {
+    ::posix_fadvise(fd_, static_cast<off_t>(off), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+  }
+
+  [[nodiscard]] std::uint64_t size() const noexcept {
+    struct stat st{};
+    return ::fstat(fd_, &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+  }
+
+  [[nodiscard]] int native_handle() const noexcept { return fd_; }
+
+private:
+  static constexpr std::size_t kMaxIov = 1024; // IOV_MAX в Linux
+
+  bool preadv_all(std::uint64_t off, std::span<iovec> iov) const noexcept {
+    while (not iov.empty()) {
+      const auto n = ::preadv(fd_, iov.data(), static_cast<int>(iov.size()), static_cast<off_t>(off));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      off += static_cast<std::uint64_t>(n);
+
+      // короткое чтение: пропускаем заполненные буферы и сдвигаем начало недочитанного
+      auto done = static_cast<std::size_t>(n);
+      while (not iov.empty() && done >= iov.front().iov_len) {
+        done -= iov.front().iov_len;
+        iov = iov.subspan(1);
+      }
+      if (not iov.empty()) {
+        iov.front().iov_base = static_cast<std::byte*>(iov.front().iov_base) + done;
+        iov.front().iov_len -= done;
+      }
+    }
+    return true;
+  }
+
+  void close() noexcept {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  int fd_ = -1;
+};
+
+CONTAINERFS_NAMESPACE_END
\ No newline at end of file
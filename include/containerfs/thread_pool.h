@@ -0,0 +1,142 @@
+#pragma once
+
+#include "namespace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+CONTAINERFS_NAMESPACE_BEGIN
+
+/**
+ * Пул потоков с общей FIFO очередью задач.
+ * Деструктор дожидается выполнения всех уже поставленных задач.
+ */
+class ThreadPool final {
+public:
+  using Task = std::move_only_function<void()>;
+
+  explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency()) {
+    threads = std::max<std::size_t>(threads, 1);
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers_.emplace_back([this] { run(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock{mutex_};
+      stop_ = true;
+    }
+    cv_.notify_all();
+    workers_.clear();
+  }
+
+  void submit(Task task) {
+    {
+      std::lock_guard lock{mutex_};
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return workers_.size(); }
+
+private:
+  void run() {
+    for (;;) {
+      Task task;
+      {
+        std::unique_lock lock{mutex_};
+        cv_.wait(lock, [this] { return stop_ || not tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Task> tasks_;
+  bool stop_ = false;
+  std::vector<std::jthread> workers_;
+};
+
+// Всё, чему можно отдать задачу на выполнение: ThreadPool или исполнитель вызывающего кода
+template<class E>
+concept Executor = requires(E& executor, ThreadPool::Task task) {
+  executor.submit(std::move(task));
+};
+
+// Исполнитель без потоков: задача выполняется прямо в submit. parallel_for с ним - обычный последовательный цикл
+struct InlineExecutor {
+  void submit(ThreadPool::Task task) { task(); }
+  [[nodiscard]] static constexpr std::size_t size() noexcept { return 0; }
+};
+
+/**
+ * f(i) для каждого i из [0, count) на потоках executor; возвращается, когда все вызовы завершились. Вызывающий поток
+ * разбирает общий счётчик наравне с пулом, поэтому parallel_for можно звать из задачи того же пула. f не бросает.
+ */
+template<Executor E, typename F>
+void parallel_for(E& executor, std::size_t count, F f) {
+  struct State {
+    std::atomic<std::size_t> next = 0;
+    std::size_t count = 0;
+    F* f = nullptr;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t finished = 0;
+
+    void drain() {
+      std::size_t done = 0;
+      for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+        (*f)(i);
+        ++done;
+      }
+      if (done != 0) {
+        std::lock_guard lock{mutex};
+        if ((finished += done) == count) {
+          cv.notify_all();
+        }
+      }
+    }
+  };
+
+  if (count == 0) {
+    return;
+  }
+
+  // состояние общее с задачами: задача, взятая пулом уже после возврата, должна найти его живым
+  auto state = std::make_shared<State>();
+  state->count = count;
+  state->f = std::addressof(f);
+
+  auto helpers = count - 1;
+  if constexpr (requires { executor.size(); }) {
+    helpers = std::min<std::size_t>(helpers, executor.size());
+  }
+  for (std::size_t i = 0; i < helpers; ++i) {
+    executor.submit([state] { state->drain(); });
+  }
+
+  state->drain();
+  std::unique_lock lock{state->mutex};
+  state->cv.wait(lock, [&] { return state->finished == count; });
+}
+
+CONTAINERFS_NAMESPACE_END
\ No newline at end of file
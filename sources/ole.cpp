@@ -1,4 +1,5 @@
 #include "containerfs/ole.h"
+#include "containerfs/ole_lazy.h"
 // #include "containerfs/ole.h"
 // #include <vector>
 //
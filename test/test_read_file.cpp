@@ -1,10 +1,22 @@
 #include "containerfs/ole.h"
+#include "containerfs/ole_lazy.h"
 #include "containerfs/filesystem.h"
 
 #include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <memory_resource>
+#include <set>
+#include <thread>
 #include <vector>
 #include <iostream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace ole {
 template<typename T>
 std::ostream& operator<<(std::ostream& os, T t) requires (std::is_enum_v<T>) {
@@ -14,6 +26,24 @@ std::ostream& operator<<(std::ostream& os, T t) requires (std::is_enum_v<T>) {
 
 using namespace containerfs;
 
+// Счётчик аллокаций для проверок "без аллокаций"
+static std::atomic<std::size_t> allocations = 0;
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+// GCC не видит, что operator new выше тоже берёт память у malloc
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
 std::vector<std::byte> read_file(const std::filesystem::path& path) {
   std::ifstream file{path, std::ios::binary | std::ios::in};
   std::vector<std::byte> result;
@@ -23,6 +53,10 @@ std::vector<std::byte> read_file(const std::filesystem::path& path) {
   return result;
 }
 
+// Потоки nauka_i_osmislenie.doc: WordDocument в несколько участков FAT, \1CompObj - в мини-потоке
+constexpr std::array<const char*, 5> kWordStreams{"WordDocument", "1Table", "\5SummaryInformation",
+                                                  "\5DocumentSummaryInformation", "\1CompObj"};
+
 TEST(Exists, Positive) {
   using namespace std::filesystem;
 
@@ -65,6 +99,1253 @@ TEST(Exists, Negative) {
   }
 }
 
+TEST(Exists, PositiveMmapDevice) {
+  using namespace std::filesystem;
+
+  const path file{"exists.ole"};
+  EXPECT_TRUE(exists(file));
+  MmapDevice dev{file};
+
+  auto fs = mount<OleDriver>(std::move(dev));
+  EXPECT_TRUE(fs) << fs.error();
+
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    auto p = ole::Path::make(dir_entry.path());
+    EXPECT_TRUE(p) << p.error();
+    EXPECT_TRUE(fs->exists(*p)) << *p;
+  }
+}
+
+TEST(String, FoldedCompare) {
+  const auto make = [](std::u16string_view s) { return *ole::String::make(s); };
+  EXPECT_LT(make(u"zz"), make(u"aaa")); // сначала длина
+  EXPECT_EQ(make(u"WordDocument"), make(u"worddocument"));
+  EXPECT_EQ(make(u"WordDocument").folded(), u"WORDDOCUMENT");
+  // различие в последнем code unit второго блока и не-ASCII символы не сворачиваются
+  EXPECT_LT(make(u"0123456789abcdef0123456789abcdA"), make(u"0123456789ABCDEF0123456789ABCDb"));
+  EXPECT_NE(make(u"\u00e9"), make(u"\u00c9"));
+  EXPECT_EQ(make(u"\1CompObj") <=> make(u"\1compobj"), std::strong_ordering::equal);
+}
+
+TEST(String, InlineStorage) {
+  const auto before = allocations.load();
+  const auto name = *ole::String::make(std::u16string_view{u"0123456789ABCDEF0123456789abcde"});
+  ole::DirectoryEntry entry{};
+  entry.name = name;
+  const std::vector<ole::DirectoryEntry> dirs(1000, entry);
+  EXPECT_EQ(allocations.load(), before + 1); // только массив записей
+  EXPECT_EQ(std::u16string_view{dirs.back().name}, u"0123456789ABCDEF0123456789abcde");
+
+  std::array<std::byte, ole::String::kBytes> raw{};
+  std::ranges::copy(std::as_bytes(std::span{u"Root Entry"}), raw.begin());
+  const auto root = ole::String::make(raw, 22);
+  ASSERT_TRUE(root) << root.error();
+  EXPECT_EQ(std::u16string_view{*root}, u"Root Entry");
+  EXPECT_EQ(ole::String::make(raw, 20).error(), ole::Error::NotNullTerminated);
+}
+
+TEST(Exists, CaseInsensitiveIndex) {
+  auto fs = mount<OleDriver>(FileDevice{"exists.ole"});
+  ASSERT_TRUE(fs) << fs.error();
+
+  EXPECT_TRUE(fs->exists(*ole::Path::make("EXISTS/A/b")));
+  EXPECT_TRUE(fs->is_directory("Exists/B"));
+  EXPECT_EQ(fs->file_size("exists/C/c/C.TXT"), 0);
+  EXPECT_FALSE(fs->exists(*ole::Path::make("exists/a/a/a")));
+  EXPECT_FALSE(fs->is_directory("/exists/a"));
+  EXPECT_FALSE(fs->is_directory("exists/a/"));
+
+  // поиск по индексу не аллоцирует
+  const auto path = *ole::Path::make("exists/c/c/c.txt");
+  const std::filesystem::path fs_path{"exists/b/a"};
+  const auto before = allocations.load();
+  EXPECT_TRUE(fs->exists(path));
+  EXPECT_TRUE(fs->is_directory(fs_path));
+  EXPECT_EQ(allocations.load(), before);
+}
+
+TEST(RecursiveDirectoryView, MatchesDisk) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(FileDevice{path{"exists.ole"}});
+  ASSERT_TRUE(fs) << fs.error();
+
+  // в контейнере лежит копия каталога exists целиком, вместе с ним самим
+  std::set<path> expected{"exists"};
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    expected.insert(dir_entry.path());
+  }
+
+  // хранилище выдаётся раньше своего содержимого, каждая запись - один раз
+  std::set<path> seen;
+  for (const auto& [name, entry] : fs->recursive_directory_view()) {
+    const path p{std::u16string{name.str()}};
+    EXPECT_TRUE(p.parent_path().empty() || seen.contains(p.parent_path())) << p;
+    EXPECT_TRUE(seen.insert(p).second) << p;
+    EXPECT_EQ(entry.type == ole::file_type::directory, is_directory(p)) << p;
+    EXPECT_TRUE(fs->exists(name)) << p;
+  }
+  EXPECT_EQ(seen, expected);
+}
+
+TEST(Extract, MatchesDisk) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(PosixFileDevice{path{"exists.ole"}});
+  ASSERT_TRUE(fs) << fs.error();
+
+  const auto dest = temp_directory_path() / "containerfs_extract";
+  remove_all(dest);
+  ThreadPool pool{4};
+  const auto stats = fs->extract_all(dest, pool);
+  ASSERT_TRUE(stats) << stats.error();
+
+  std::uint64_t files = 0;
+  std::uint64_t bytes = 0;
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    const auto extracted = dest / dir_entry.path();
+    if (dir_entry.is_directory()) {
+      EXPECT_TRUE(is_directory(extracted)) << extracted;
+      continue;
+    }
+    ++files;
+    bytes += dir_entry.file_size();
+    EXPECT_EQ(read_file(extracted), read_file(dir_entry.path())) << extracted;
+  }
+  EXPECT_EQ(stats->files, files);
+  EXPECT_EQ(stats->bytes, bytes);
+  EXPECT_GT(stats->bytes_per_second(), 0);
+
+  // поддерево - содержимое хранилища прямо в dest, без пула
+  remove_all(dest);
+  const auto subtree = fs->extract_subtree(path{"exists"}, dest);
+  ASSERT_TRUE(subtree) << subtree.error();
+  EXPECT_EQ(subtree->files, files);
+  EXPECT_TRUE(exists(dest / begin(directory_iterator("exists"))->path().filename()));
+  EXPECT_EQ(fs->extract_subtree(path{"missing"}, dest).error(), ole::Error::NotFound);
+  remove_all(dest);
+}
+
+TEST(Extract, WordDocument) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(PosixFileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(fs) << fs.error();
+  std::uint64_t bytes = 0;
+  for (const auto* name : kWordStreams) {
+    bytes += fs->read_file(name).size();
+  }
+
+  const auto dest = temp_directory_path() / "containerfs_extract_doc";
+  const auto expect_extracted = [&](const auto& stats, std::size_t buffer_size) {
+    ASSERT_TRUE(stats) << stats.error() << " buffer " << buffer_size;
+    EXPECT_EQ(stats->files, kWordStreams.size());
+    EXPECT_EQ(stats->bytes, bytes);
+    for (const auto* name : kWordStreams) {
+      EXPECT_EQ(read_file(dest / name), fs->read_file(name)) << name << " buffer " << buffer_size;
+    }
+  };
+
+  // все участки в одном буфере; 4096 и 1000 - участки WordDocument делятся между буферами, в том числе
+  // посреди сектора. \1CompObj пишется из мини-потока отдельной задачей
+  ThreadPool pool{4};
+  for (const std::size_t buffer_size : {kExtractBufferSize, std::size_t{4096}, std::size_t{1000}}) {
+    remove_all(dest);
+    expect_extracted(fs->extract_all(dest, pool, buffer_size), buffer_size);
+    remove_all(dest);
+    expect_extracted(fs->extract_all(dest, InlineExecutor{}, buffer_size), buffer_size);
+  }
+
+  // один поток: файл dest/<имя потока>
+  remove_all(dest);
+  const auto single = fs->extract_subtree(path{"WordDocument"}, dest, pool, 4096);
+  ASSERT_TRUE(single) << single.error();
+  EXPECT_EQ(single->files, 1u);
+  EXPECT_EQ(read_file(dest / "WordDocument"), fs->read_file("WordDocument"));
+  remove_all(dest);
+}
+
+// Поток дописывается с текущей позиции дескриптора: перед ним в файле остаётся prefix
+template <typename Device>
+void expect_copies_match_read_file(int flags) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(Device{path{"nauka_i_osmislenie.doc"}});
+  ASSERT_TRUE(fs) << fs.error();
+  const auto out = temp_directory_path() / "containerfs_copy_stream";
+  const std::array prefix{std::byte{'o'}, std::byte{'l'}, std::byte{'e'}};
+  for (const auto* name : kWordStreams) {
+    const int fd = ::open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | flags, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, prefix.data(), prefix.size()), static_cast<ssize_t>(prefix.size()));
+    const auto copied = fs->copy_stream_to(name, fd);
+    ::close(fd);
+    ASSERT_TRUE(copied) << copied.error() << " " << name;
+
+    auto expected = fs->read_file(name);
+    ASSERT_FALSE(expected.empty()) << name;
+    EXPECT_EQ(*copied, expected.size()) << name;
+    expected.insert(expected.begin(), prefix.begin(), prefix.end());
+    EXPECT_EQ(read_file(out), expected) << name;
+  }
+  remove(out);
+  EXPECT_EQ(fs->copy_stream_to(path{"nonexistent"}, 1).error(), ole::Error::NotAStream);
+}
+
+TEST(CopyStreamTo, MatchesReadFile) {
+  expect_copies_match_read_file<PosixFileDevice>(0);        // copy_file_range
+  expect_copies_match_read_file<PosixFileDevice>(O_APPEND); // copy_file_range: EBADF, sendfile: EINVAL, буфер
+  expect_copies_match_read_file<MmapDevice>(0);             // прямо из отображения
+  expect_copies_match_read_file<FileDevice>(0);             // через буфер
+}
+
+TEST(CopyStreamTo, Pipe) {
+  auto fs = mount<OleDriver>(PosixFileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(fs) << fs.error();
+
+  // в канал copy_file_range не пишет (EINVAL), байты уходят через sendfile; читатель забирает их параллельно,
+  // иначе WordDocument не поместился бы в буфер канала
+  for (const auto* name : kWordStreams) {
+    std::array<int, 2> fds{};
+    ASSERT_EQ(::pipe2(fds.data(), O_CLOEXEC), 0);
+    auto reader = std::async(std::launch::async, [fd = fds[0]] {
+      std::vector<std::byte> bytes;
+      std::array<std::byte, 65536> chunk{};
+      for (ssize_t n; (n = ::read(fd, chunk.data(), chunk.size())) > 0;) {
+        bytes.insert(bytes.end(), chunk.begin(), chunk.begin() + n);
+      }
+      ::close(fd);
+      return bytes;
+    });
+    const auto copied = fs->copy_stream_to(name, fds[1]);
+    ::close(fds[1]);
+    ASSERT_TRUE(copied) << copied.error() << " " << name;
+    EXPECT_EQ(reader.get(), fs->read_file(name)) << name;
+  }
+}
+
+TEST(PathView, Segments) {
+  const auto segments = [](auto view) {
+    std::vector<std::u16string> result;
+    for (const auto segment : view) {
+      result.emplace_back(segment.begin(), segment.end());
+    }
+    return result;
+  };
+  using V = std::vector<std::u16string>;
+  EXPECT_EQ(segments(ole::PathView{u"a/bc/d"}), (V{u"a", u"bc", u"d"}));
+  EXPECT_EQ(segments(ole::PathView{u""}), V{});
+  EXPECT_EQ(segments(ole::PathView{u"/a//b/"}), (V{u"", u"a", u"", u"b", u""}));
+
+  // обход с конца даёт те же сегменты
+  const ole::PathView view{u"/a//bc"};
+  V reversed;
+  for (auto it = view.end(); it != view.begin();) {
+    const auto segment = *--it;
+    reversed.emplace(reversed.begin(), segment.begin(), segment.end());
+  }
+  EXPECT_EQ(reversed, segments(view));
+  static_assert(std::ranges::bidirectional_range<ole::PathView<>>);
+}
+
+TEST(PathView, LookupWithoutAllocation) {
+  auto fs = mount<OleDriver>(FileDevice{"exists.ole"});
+  ASSERT_TRUE(fs) << fs.error();
+  const std::filesystem::path native{"exists/C/c/c.txt"};
+
+  const auto before = allocations.load();
+  EXPECT_TRUE(fs->exists(ole::PathView{u"exists/a/B"}));
+  EXPECT_TRUE(fs->is_directory(ole::PathView{"exists/b"}));
+  EXPECT_EQ(fs->file_size(ole::PathView{native}), 0);
+  EXPECT_FALSE(fs->exists(ole::PathView{u"exists//a"}));
+  EXPECT_FALSE(fs->exists(ole::PathView{u"exists/a/b/"}));
+  EXPECT_FALSE(fs->exists(ole::PathView{u"exists/a:b"}));
+  EXPECT_EQ(allocations.load(), before);
+}
+
+TEST(MmapDevice, ViewMatchesRead) {
+  using namespace std::filesystem;
+
+  const path file{"exists.ole"};
+  MmapDevice mapped{file};
+  FileDevice dev{file};
+  ASSERT_EQ(mapped.size(), file_size(file));
+
+  std::vector<std::byte> expected(mapped.size());
+  ASSERT_TRUE(dev.read_at(0, expected));
+  EXPECT_TRUE(std::ranges::equal(mapped.view_at(0, mapped.size()), expected));
+
+  std::vector<std::byte> actual(512);
+  ASSERT_TRUE(mapped.read_at(512, actual));
+  EXPECT_TRUE(std::ranges::equal(actual, std::span{expected}.subspan(512, 512)));
+
+  EXPECT_TRUE(mapped.view_at(mapped.size(), 1).empty());
+  EXPECT_FALSE(mapped.read_at(mapped.size() - 1, actual));
+}
+
+static_assert(ConcurrentReadableDevice<PosixFileDevice>);
+static_assert(ConcurrentReadableDevice<MmapDevice>);
+static_assert(not ConcurrentReadableDevice<FileDevice>);
+
+TEST(PosixFileDevice, SharedMountAcrossThreads) {
+  using namespace std::filesystem;
+
+  const path file{"exists.ole"};
+  std::vector<std::byte> expected(file_size(file));
+  ASSERT_TRUE(FileDevice{file}.read_at(0, expected));
+
+  const PosixFileDevice dev{file};
+  ASSERT_EQ(dev.size(), expected.size());
+
+  auto fs = mount<OleDriver>(PosixFileDevice{file});
+  ASSERT_TRUE(fs) << fs.error();
+
+  std::vector<path> paths;
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    paths.push_back(dir_entry.path());
+  }
+
+  std::vector<std::jthread> workers;
+  std::atomic<int> failures{0};
+  for (std::size_t t = 0; t < 8; ++t) {
+    workers.emplace_back([&, t] {
+      std::vector<std::byte> buf(512);
+      for (std::size_t i = t; i + buf.size() <= expected.size(); i += 97) {
+        if (not dev.read_at(i, buf) || not std::ranges::equal(buf, std::span{expected}.subspan(i, buf.size()))) {
+          ++failures;
+        }
+      }
+      for (const auto& p : paths) {
+        if (not fs->exists(*ole::Path::make(p))) {
+          ++failures;
+        }
+      }
+    });
+  }
+  workers.clear();
+
+  EXPECT_EQ(failures, 0);
+}
+
+TEST(ParallelFor, EveryIndexOnceEvenFromPoolTask) {
+  ThreadPool pool{1};
+  std::vector<std::atomic<int>> hits(1000);
+  parallel_for(pool, hits.size(), [&](std::size_t i) { ++hits[i]; });
+  EXPECT_TRUE(std::ranges::all_of(hits, [](const auto& h) { return h == 1; }));
+
+  // единственный поток пула занят вызывающей задачей: всё выполняет она сама
+  std::promise<int> total;
+  pool.submit([&] {
+    std::atomic<int> sum = 0;
+    parallel_for(pool, 100, [&](std::size_t i) { sum += static_cast<int>(i); });
+    total.set_value(sum);
+  });
+  EXPECT_EQ(total.get_future().get(), 4950);
+}
+
+TEST(ParallelMount, MatchesSequential) {
+  ThreadPool pool{4};
+  auto sequential = mount<OleDriver>(PosixFileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(sequential) << sequential.error();
+
+  auto check = [&](auto&& fs) {
+    ASSERT_TRUE(fs) << fs.error();
+    for (const auto* name : {"WordDocument", "1Table", "\1CompObj", "\5SummaryInformation"}) {
+      EXPECT_EQ(fs->read_file(name), sequential->read_file(name)) << name;
+    }
+  };
+  check(mount<OleDriver>(PosixFileDevice{"nauka_i_osmislenie.doc"}, pool));
+  check(mount<OleDriver>(MmapDevice{"nauka_i_osmislenie.doc"}, pool));
+  // FileDevice читается последовательно, параллелен только разбор каталога
+  check(mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"}, pool));
+}
+
+// Память через new_delete_resource с подсчётом выделений и невозвращённых байт
+class CountingResource final : public std::pmr::memory_resource {
+public:
+  std::size_t allocations = 0;
+  std::size_t live = 0;
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    ++allocations;
+    live += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+    live -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+TEST(MountResource, MetadataComesFromResource) {
+  auto reference = mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(reference) << reference.error();
+  const auto check = [&](auto& fs) {
+    for (const auto* name : {"WordDocument", "1Table", "\1CompObj", "\5SummaryInformation"}) {
+      EXPECT_EQ(fs.read_file(name), reference->read_file(name)) << name;
+    }
+  };
+
+  CountingResource counting;
+  {
+    auto fs = mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"}, &counting);
+    ASSERT_TRUE(fs) << fs.error();
+    const auto mounted = counting.allocations;
+    EXPECT_GT(mounted, 0u);
+    check(*fs);
+    // чтения и ленивые индексы участков resource не трогают
+    EXPECT_EQ(counting.allocations, mounted);
+  }
+  EXPECT_EQ(counting.live, 0u);
+
+  ThreadPool pool{4};
+  std::pmr::monotonic_buffer_resource arena;
+  auto parallel = mount<OleDriver>(PosixFileDevice{"nauka_i_osmislenie.doc"}, pool, &arena);
+  ASSERT_TRUE(parallel) << parallel.error();
+  check(*parallel);
+
+  // Собственная арена драйвера берёт блоки у ресурса по умолчанию: их меньше, чем выделений без арены,
+  // и все они возвращаются вместе с драйвером
+  CountingResource upstream;
+  auto* const previous = std::pmr::set_default_resource(&upstream);
+  if (auto fs = mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"})) {
+    EXPECT_LT(upstream.allocations, counting.allocations);
+    check(*fs);
+  } else {
+    ADD_FAILURE() << fs.error();
+  }
+  std::pmr::set_default_resource(previous);
+  EXPECT_GT(upstream.allocations, 0u);
+  EXPECT_EQ(upstream.live, 0u);
+}
+
+// Драйвер с собственной ареной перемещается целиком: метаданные и арена уходят вместе, старые освобождаются
+TEST(MountResource, MoveAssignAndConstruct) {
+  const std::filesystem::path doc{"nauka_i_osmislenie.doc"};
+  auto reference = mount<OleDriver>(FileDevice{doc});
+  ASSERT_TRUE(reference) << reference.error();
+
+  CountingResource upstream;
+  auto* const previous = std::pmr::set_default_resource(&upstream);
+  {
+    auto target = mount<OleDriver>(FileDevice{"exists.ole"});
+    auto source = mount<OleDriver>(FileDevice{doc});
+    ASSERT_TRUE(target) << target.error();
+    ASSERT_TRUE(source) << source.error();
+
+    *target = std::move(*source);
+    EXPECT_FALSE(target->exists("exists"));
+    for (const auto* name : {"WordDocument", "\1CompObj"}) {
+      EXPECT_EQ(target->read_file(name), reference->read_file(name)) << name;
+    }
+
+    auto moved = std::move(*target);
+    EXPECT_EQ(moved.file_size("WordDocument"), 112174);
+    EXPECT_EQ(moved.read_file("\1CompObj"), reference->read_file("\1CompObj"));
+  }
+  std::pmr::set_default_resource(previous);
+  EXPECT_EQ(upstream.live, 0u);
+}
+
+// Считает обращения к устройству, чтобы проверить склейку запросов
+struct CountingDevice {
+  FileDevice dev;
+  std::shared_ptr<int> reads = std::make_shared<int>(0);
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) {
+    ++*reads;
+    return dev.read_at(off, dst);
+  }
+};
+
+TEST(ReadMany, DevicesAgree) {
+  using namespace std::filesystem;
+
+  const path file{"exists.ole"};
+  std::vector<std::byte> expected(file_size(file));
+  ASSERT_TRUE(FileDevice{file}.read_at(0, expected));
+  ASSERT_GE(expected.size(), 4096u);
+
+  // два соседних на диске запроса в разрывную память, разрыв, и запрос назад
+  auto check = [&](auto&& dev) {
+    std::vector<std::byte> buf(2048);
+    const std::array requests{
+      ReadRequest{512, std::span{buf}.subspan(1024, 512)},
+      ReadRequest{1024, std::span{buf}.subspan(0, 512)},
+      ReadRequest{3072, std::span{buf}.subspan(512, 512)},
+      ReadRequest{0, std::span{buf}.subspan(1536, 512)},
+    };
+    ASSERT_TRUE(read_many(dev, requests));
+    for (const auto& [offset, dst] : requests) {
+      EXPECT_TRUE(std::ranges::equal(dst, std::span{expected}.subspan(offset, dst.size()))) << offset;
+    }
+
+    const std::array past_end{ReadRequest{expected.size() - 256, std::span{buf}.first(512)}};
+    EXPECT_FALSE(read_many(dev, past_end));
+  };
+
+  check(FileDevice{file});
+  check(PosixFileDevice{file});
+  check(MmapDevice{file});
+}
+
+TEST(ReadMany, AdjacentRequestsAreMerged) {
+  CountingDevice dev{FileDevice{"exists.ole"}};
+  std::vector<std::byte> buf(1536);
+  const std::array requests{
+    ReadRequest{512, std::span{buf}.subspan(0, 512)},
+    ReadRequest{1024, std::span{buf}.subspan(512, 512)},
+    ReadRequest{0, std::span{buf}.subspan(1024, 512)},
+  };
+  ASSERT_TRUE(read_many(dev, requests));
+  EXPECT_EQ(*dev.reads, 2);
+
+  // загрузчики OLE идут через read_many и работают с устройством без нативной поддержки
+  auto fs = mount<OleDriver>(std::move(dev));
+  ASSERT_TRUE(fs) << fs.error();
+  EXPECT_TRUE(fs->exists(*ole::Path::make("exists/a/a")));
+}
+
+static_assert(ConcurrentReadableDevice<CachedDevice<FileDevice>>);
+
+TEST(CachedDevice, HitsMissesAndEviction) {
+  using namespace std::filesystem;
+
+  const path file{"exists.ole"};
+  std::vector<std::byte> expected(file_size(file));
+  ASSERT_TRUE(FileDevice{file}.read_at(0, expected));
+
+  // 4 блока по 512 байт на один шард: пятый блок вытесняет
+  CachedDevice dev{FileDevice{file}, 4 * 512, 512, 1};
+  std::vector<std::byte> buf(3 * 512);
+  ASSERT_TRUE(dev.read_at(300, std::span{buf}.first(700))); // блоки 0 и 1
+  EXPECT_TRUE(std::ranges::equal(std::span{buf}.first(700), std::span{expected}.subspan(300, 700)));
+  EXPECT_EQ(dev.stats().misses, 2u);
+  EXPECT_EQ(dev.stats().hits, 0u);
+
+  ASSERT_TRUE(dev.read_at(0, std::span{buf}.first(100)));
+  EXPECT_EQ(dev.stats().hits, 1u);
+
+  ASSERT_TRUE(dev.read_at(1024, std::span{buf}.first(512 * 3))); // блоки 2, 3, 4
+  EXPECT_EQ(dev.stats().misses, 5u);
+  ASSERT_TRUE(dev.read_at(2048, std::span{buf}.first(512)));
+  EXPECT_EQ(dev.stats().hits, 2u);
+
+  // хвост устройства без size(): последний неполный блок и чтение за концом
+  ASSERT_TRUE(dev.read_at(expected.size() - 10, std::span{buf}.first(10)));
+  EXPECT_TRUE(std::ranges::equal(std::span{buf}.first(10), std::span{expected}.last(10)));
+  EXPECT_FALSE(dev.read_at(expected.size() - 10, std::span{buf}.first(11)));
+}
+
+TEST(CachedDevice, SharedMountAcrossThreads) {
+  auto fs = mount<OleDriver>(CachedDevice{PosixFileDevice{"nauka_i_osmislenie.doc"}, 64 * 1024, 4096, 4});
+  ASSERT_TRUE(fs) << fs.error();
+  const auto expected = fs->read_file("WordDocument");
+  ASSERT_EQ(expected.size(), 112174u);
+
+  std::atomic<int> failures = 0;
+  std::vector<std::jthread> workers;
+  for (int i = 0; i < 8; ++i) {
+    workers.emplace_back([&] {
+      for (int j = 0; j < 20; ++j) {
+        if (fs->read_file("WordDocument") != expected) {
+          ++failures;
+        }
+      }
+    });
+  }
+  workers.clear();
+  EXPECT_EQ(failures, 0);
+}
+
+TEST(ReadFile, MatchesDisk) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(FileDevice{"exists.ole"});
+  ASSERT_TRUE(fs) << fs.error();
+
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    if (dir_entry.is_regular_file()) {
+      EXPECT_EQ(fs->read_file(dir_entry.path()), read_file(dir_entry.path())) << dir_entry;
+    }
+  }
+  EXPECT_TRUE(fs->read_file("exists/nonexistent_path").empty());
+}
+
+template <typename FS>
+void expect_ranges_match(FS& fs, const std::filesystem::path& path, const std::vector<std::byte>& expected) {
+  const auto size = expected.size();
+  std::vector<std::byte> buffer(std::max<std::size_t>(size, 50'000));
+  std::array<std::byte, 4096> arena{};
+
+  const auto whole = fs.read_into(path, buffer);
+  ASSERT_TRUE(whole) << whole.error() << " " << path;
+  EXPECT_TRUE(std::ranges::equal(std::span{buffer}.first(*whole), expected)) << path;
+  if (size != 0) {
+    EXPECT_EQ(fs.read_into(path, std::span{buffer}.first(size - 1)).error(), ole::Error::BufferTooSmall) << path;
+  }
+
+  // границы мини-секторов, секторов и конца потока; 50000 байт проходят через несколько участков
+  std::vector<std::uint64_t> offsets{0, 1, 63, 64, 511, 4095, 4097, size / 2, size, size + 10};
+  if (size != 0) {
+    offsets.push_back(size - 1);
+  }
+  for (const auto offset : offsets) {
+    for (const std::size_t length : {700u, 50'000u}) {
+      const auto read = fs.read_range(path, offset, std::span{buffer}.first(length));
+      ASSERT_TRUE(read) << read.error();
+      const auto from = std::min<std::uint64_t>(offset, size);
+      const auto count = std::min<std::uint64_t>(length, size - from);
+      ASSERT_EQ(*read, count) << path << " @" << offset;
+      EXPECT_TRUE(std::ranges::equal(std::span{buffer}.first(*read), std::span{expected}.subspan(from, count)))
+          << path << " @" << offset << " +" << length;
+    }
+  }
+
+  std::pmr::monotonic_buffer_resource resource{arena.data(), arena.size()};
+  EXPECT_TRUE(std::ranges::equal(fs.read_file(path, &resource), expected)) << path;
+}
+
+template <typename FS>
+void expect_ranges_match_disk(FS& fs) {
+  using namespace std::filesystem;
+
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    if (dir_entry.is_regular_file()) {
+      expect_ranges_match(fs, dir_entry.path(), read_file(dir_entry.path()));
+    }
+  }
+  std::vector<std::byte> buffer(16);
+  EXPECT_EQ(fs.read_range(path{"exists"}, 0, buffer).error(), ole::Error::NotAStream);
+}
+
+TEST(ReadRange, MatchesDisk) {
+  auto fs = mount<OleDriver>(FileDevice{"exists.ole"});
+  ASSERT_TRUE(fs) << fs.error();
+  expect_ranges_match_disk(*fs);
+
+  auto lazy = mount<LazyOleDriver>(FileDevice{"exists.ole"}, 2);
+  ASSERT_TRUE(lazy) << lazy.error();
+  expect_ranges_match_disk(*lazy);
+}
+
+TEST(ReadRange, WordDocument) {
+  auto fs = mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(fs) << fs.error();
+  // у ленивого драйвера метаданные вытесняются и перечитываются по ходу чтения
+  auto lazy = mount<LazyOleDriver>(FileDevice{"nauka_i_osmislenie.doc"}, 2);
+  ASSERT_TRUE(lazy) << lazy.error();
+
+  for (const auto* name : kWordStreams) {
+    const auto expected = fs->read_file(name);
+    ASSERT_FALSE(expected.empty()) << name;
+    expect_ranges_match(*fs, name, expected);
+    expect_ranges_match(*lazy, name, expected);
+  }
+}
+
+template <typename Device>
+void expect_chunks_match_read_file(std::size_t chunk_size) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(Device{path{"nauka_i_osmislenie.doc"}});
+  ASSERT_TRUE(fs) << fs.error();
+  for (const auto* name : kWordStreams) {
+    const auto expected = fs->read_file(name);
+    auto chunks = fs->read_chunks(name, chunk_size);
+    ASSERT_TRUE(chunks) << chunks.error();
+    ASSERT_EQ(chunks->chunk_size(), std::min(chunk_size, expected.size())) << name;
+
+    std::vector<std::byte> joined;
+    std::size_t count = 0;
+    std::ranges::for_each(*chunks, [&](std::span<const std::byte> chunk) {
+      EXPECT_LE(chunk.size(), chunks->chunk_size());
+      joined.insert(joined.end(), chunk.begin(), chunk.end());
+      ++count;
+    });
+    EXPECT_FALSE(chunks->failed()) << name;
+    EXPECT_EQ(joined, expected) << name << " chunk " << chunk_size;
+    EXPECT_EQ(count, (expected.size() + chunks->chunk_size() - 1) / chunks->chunk_size()) << name;
+  }
+}
+
+static_assert(std::ranges::input_range<OleChunkRange<FileDevice>>);
+static_assert(std::ranges::view<OleChunkRange<FileDevice>>);
+
+TEST(ReadChunks, WordDocument) {
+  // кусок меньше сектора, ровно сектор и посреди секторов; 200000 больше любого потока - один кусок
+  for (const std::size_t chunk_size : {100u, 512u, 1000u, 4096u, 30'000u, 200'000u}) {
+    expect_chunks_match_read_file<FileDevice>(chunk_size);      // чтение при переходе к куску
+    expect_chunks_match_read_file<PosixFileDevice>(chunk_size); // prefetch следующего куска, чтение при переходе
+    expect_chunks_match_read_file<MmapDevice>(chunk_size);
+    expect_chunks_match_read_file<IoUringDevice>(chunk_size);   // следующий кусок читается асинхронно
+  }
+}
+
+TEST(ReadChunks, EmptyStreamAndStorage) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(FileDevice{path{"exists.ole"}});
+  ASSERT_TRUE(fs) << fs.error();
+  auto chunks = fs->read_chunks(path{"exists/c/c/c.txt"}, 1000);
+  ASSERT_TRUE(chunks) << chunks.error();
+  EXPECT_EQ(std::ranges::distance(*chunks), 0);
+  EXPECT_FALSE(chunks->failed());
+  EXPECT_EQ(fs->read_chunks(path{"exists"}, 1000).error(), ole::Error::NotAStream);
+  EXPECT_TRUE(OleChunkRange<FileDevice>::iterator{} == std::default_sentinel);
+}
+
+TEST(ReadChunks, StopEarly) {
+  auto fs = mount<OleDriver>(IoUringDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(fs) << fs.error();
+  const auto expected = fs->read_file("WordDocument");
+
+  // потребитель уходит раньше конца: деструктор range дожидается чтений, которые ещё идут в его буферы
+  for (const std::size_t stop : {0u, 1u, 3u}) {
+    std::vector<std::byte> head;
+    {
+      auto chunks = fs->read_chunks("WordDocument", 4096);
+      ASSERT_TRUE(chunks) << chunks.error();
+      std::size_t seen = 0;
+      for (auto it = chunks->begin(); seen != stop && it != std::default_sentinel; ++it, ++seen) {
+        const auto chunk = *it;
+        head.insert(head.end(), chunk.begin(), chunk.end());
+      }
+    }
+    EXPECT_TRUE(std::ranges::equal(head, std::span{expected}.first(stop * 4096))) << stop;
+  }
+}
+
+TEST(ReadFile, WordDocument) {
+  auto fs = mount<OleDriver>(MmapDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(fs) << fs.error();
+
+  // FAT-поток: FIB начинается с wIdent = 0xA5EC
+  EXPECT_EQ(fs->file_size("WordDocument"), 112174);
+  const auto word = fs->read_file("WordDocument");
+  ASSERT_EQ(word.size(), 112174u);
+  EXPECT_EQ(word[0], std::byte{0xEC});
+  EXPECT_EQ(word[1], std::byte{0xA5});
+
+  // поток из мини-потока
+  const auto comp_obj = fs->read_file("\1CompObj");
+  ASSERT_EQ(comp_obj.size(), 106u);
+  EXPECT_EQ(comp_obj[2], std::byte{0xFE});
+  EXPECT_EQ(comp_obj[3], std::byte{0xFF});
+
+  // ровно на границе мини-потока поток уже лежит в FAT
+  EXPECT_EQ(fs->read_file("\5SummaryInformation").size(), 4096u);
+
+  EXPECT_FALSE(fs->is_directory("WordDocument"));
+  EXPECT_EQ(fs->file_size("nonexistent"), -1);
+  EXPECT_FALSE(fs->is_directory("nonexistent"));
+}
+
+TEST(ReadFile, MiniStreamIsLoadedOnce) {
+  CountingDevice dev{FileDevice{"nauka_i_osmislenie.doc"}};
+  const auto reads = dev.reads;
+  auto fs = mount<OleDriver>(std::move(dev));
+  ASSERT_TRUE(fs) << fs.error();
+
+  // маленькие потоки читаются из мини-потока, загруженного при монтировании
+  const auto mounted = *reads;
+  EXPECT_EQ(fs->read_file("\1CompObj").size(), 106u);
+  EXPECT_EQ(fs->read_file("\1CompObj").size(), 106u);
+  EXPECT_EQ(*reads, mounted);
+
+  EXPECT_EQ(fs->read_file("WordDocument").size(), 112174u);
+  EXPECT_GT(*reads, mounted);
+}
+
+TEST(LazyMount, ReadsOnlyHeaderAndRoot) {
+  CountingDevice dev{FileDevice{"nauka_i_osmislenie.doc"}};
+  const auto reads = dev.reads;
+  auto driver = LazyOleDriver<CountingDevice>::create(std::move(dev), 4);
+  ASSERT_TRUE(driver) << driver.error();
+  // заголовок и первый сектор каталога
+  EXPECT_EQ(*reads, 2);
+
+  auto eager = mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(eager) << eager.error();
+  for (const auto* name : {"WordDocument", "\1CompObj", "\5SummaryInformation", "1Table", "Data"}) {
+    const std::filesystem::path path{name};
+    EXPECT_EQ(driver->file_size(path), eager->file_size(path)) << path;
+    EXPECT_EQ(driver->read_file(path), eager->read_file(path)) << path;
+  }
+  EXPECT_FALSE(driver->exists(std::filesystem::path{"nonexistent"}));
+  EXPECT_TRUE(driver->read_file("nonexistent").empty());
+
+  // метаданные не больше заданного числа секторов, вытесненные перечитываются
+  EXPECT_LE(driver->resident_sectors(), 4u);
+  EXPECT_GT(driver->metadata_stats().hits, 0u);
+}
+
+// Устройство, которое бросает bad_alloc вместо чтения, пока поднят флаг
+struct ThrowingDevice {
+  FileDevice dev;
+  std::shared_ptr<bool> fail = std::make_shared<bool>(false);
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) {
+    if (*fail) {
+      throw std::bad_alloc{};
+    }
+    return dev.read_at(off, dst);
+  }
+};
+
+TEST(LazyMount, LookupsDoNotThrow) {
+  ThrowingDevice dev{FileDevice{"nauka_i_osmislenie.doc"}};
+  const auto fail = dev.fail;
+  auto fs = mount<LazyOleDriver>(std::move(dev), 1);
+  ASSERT_TRUE(fs) << fs.error();
+
+  // FileSystem::exists/file_size/is_directory noexcept: исключение изнутри драйвера - это "не найдено"
+  *fail = true;
+  EXPECT_FALSE(fs->exists("WordDocument"));
+  EXPECT_EQ(fs->file_size("WordDocument"), -1);
+  EXPECT_FALSE(fs->is_directory("WordDocument"));
+
+  // мьютекс отпущен, состояние целое
+  *fail = false;
+  EXPECT_TRUE(fs->exists("WordDocument"));
+  EXPECT_EQ(fs->file_size("WordDocument"), 112174);
+}
+
+TEST(ChainCheckpoints, BoundedMemoryAndShortWalks) {
+  constexpr std::uint64_t n = 100'000;
+  std::uint64_t steps = 0;
+  const auto next = [&](fat_t sid) -> std::expected<fat_t, ole::Error> {
+    ++steps;
+    return sid + 1;
+  };
+
+  ChainCheckpoints chain;
+  EXPECT_EQ(chain.at(7, n - 1, next), 7 + n - 1);
+  EXPECT_LE(chain.size(), ChainCheckpoints::kMaxCheckpoints);
+  EXPECT_LE(chain.stride() * chain.size(), 2 * n);
+
+  // произвольный доступ - не дальше stride от контрольной точки
+  for (const auto k : std::array<std::uint64_t, 5>{n / 2, 0, 12'345, n - 2, 1}) {
+    steps = 0;
+    EXPECT_EQ(chain.at(7, k, next), 7 + k) << k;
+    EXPECT_LT(steps, chain.stride()) << k;
+  }
+
+  // последовательный проход - шаг на сектор
+  steps = 0;
+  for (std::uint64_t k = 0; k < 1000; ++k) {
+    ASSERT_EQ(chain.at(7, k, next), 7 + k);
+  }
+  EXPECT_LT(steps, 1000 + chain.stride());
+
+  ChainCheckpoints broken;
+  const auto fail = [](fat_t sid) -> std::expected<fat_t, ole::Error> {
+    return sid < 500 ? std::expected<fat_t, ole::Error>{sid + 1} : std::unexpected(ole::Error::CorruptedFile);
+  };
+  EXPECT_EQ(broken.at(0, 1000, fail), std::unexpected(ole::Error::CorruptedFile));
+  EXPECT_EQ(broken.at(0, 400, fail), 400u);
+}
+
+TEST(LazyMount, MatchesDisk) {
+  using namespace std::filesystem;
+
+  auto fs = mount<LazyOleDriver>(FileDevice{"exists.ole"}, 2);
+  ASSERT_TRUE(fs) << fs.error();
+
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    EXPECT_TRUE(fs->exists(dir_entry.path())) << dir_entry;
+    EXPECT_EQ(fs->is_directory(dir_entry.path()), dir_entry.is_directory()) << dir_entry;
+    if (dir_entry.is_regular_file()) {
+      EXPECT_EQ(fs->read_file(dir_entry.path()), read_file(dir_entry.path())) << dir_entry;
+    }
+  }
+  EXPECT_FALSE(fs->exists(*ole::Path::make("")));
+  EXPECT_FALSE(fs->exists(ole::PathView{u"exists//a"}));
+}
+
+TEST(FileSize, MatchesDisk) {
+  using namespace std::filesystem;
+
+  auto fs = mount<OleDriver>(FileDevice{"exists.ole"});
+  ASSERT_TRUE(fs) << fs.error();
+
+  for (auto&& dir_entry : recursive_directory_iterator("exists")) {
+    EXPECT_EQ(fs->is_directory(dir_entry.path()), dir_entry.is_directory()) << dir_entry;
+    if (dir_entry.is_regular_file()) {
+      EXPECT_EQ(fs->file_size(dir_entry.path()), static_cast<int>(dir_entry.file_size())) << dir_entry;
+    } else {
+      EXPECT_EQ(fs->file_size(dir_entry.path()), -1) << dir_entry;
+    }
+  }
+}
+
+// Минимальный файл версии 4: заголовок, FAT-сектор 0 и сектор каталога 1 с корнем и потоком "big" размером stream_size
+void write_v4_container(const std::filesystem::path& target, std::uint64_t stream_size) {
+  constexpr std::size_t kSector = 4096;
+  std::vector<std::byte> bytes(3 * kSector);
+  const auto put = [&](std::size_t at, auto value) { std::memcpy(bytes.data() + at, &value, sizeof(value)); };
+
+  constexpr std::array<std::uint8_t, 8> magic{0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1};
+  std::memcpy(bytes.data(), magic.data(), magic.size());
+  put(0x18, std::uint16_t{0x3E});       // minor
+  put(0x1A, std::uint16_t{4});          // major
+  put(0x1C, std::uint16_t{0xFFFE});     // byte order
+  put(0x1E, std::uint16_t{12});         // sector shift
+  put(0x20, std::uint16_t{6});          // mini sector shift
+  put(0x28, std::uint32_t{1});          // секторов каталога
+  put(0x2C, std::uint32_t{1});          // FAT-секторов
+  put(0x30, std::uint32_t{1});          // первый сектор каталога
+  put(0x38, std::uint32_t{4096});       // mini stream cutoff
+  put(0x3C, ENDOFCHAIN);                // miniFAT нет
+  put(0x44, ENDOFCHAIN);                // DIFAT-секторов нет
+  put(0x4C, std::uint32_t{0});          // DIFAT[0] - FAT в секторе 0
+  for (std::size_t i = 1; i < 109; ++i) {
+    put(0x4C + i * 4, FREESECT);
+  }
+
+  const auto fat = kSector;
+  put(fat, FATSECT);
+  put(fat + 4, ENDOFCHAIN);
+  for (std::size_t i = 2; i < kSector / 4; ++i) {
+    put(fat + i * 4, FREESECT);
+  }
+
+  const auto entry = [&](std::size_t at, std::u16string_view name, std::uint8_t type, std::uint32_t child,
+                         std::uint64_t size) {
+    std::memcpy(bytes.data() + at, name.data(), name.size() * 2);
+    put(at + 64, static_cast<std::uint16_t>((name.size() + 1) * 2));
+    bytes[at + 66] = std::byte{type};
+    put(at + 68, ole::NOSTREAM);
+    put(at + 72, ole::NOSTREAM);
+    put(at + 76, child);
+    put(at + 116, ENDOFCHAIN);
+    put(at + 120, size);
+  };
+  entry(2 * kSector, u"Root Entry", 5, 1, 0);
+  entry(2 * kSector + 128, u"big", 2, ole::NOSTREAM, stream_size);
+
+  std::ofstream{target, std::ios::binary}.write(reinterpret_cast<const char*>(bytes.data()),
+                                                 static_cast<std::streamsize>(bytes.size()));
+}
+
+TEST(FileSize, StreamAboveIntMax) {
+  using namespace std::filesystem;
+
+  // int не вмещает размер: -1, а не обрезанное или отрицательное значение
+  const auto size_of = [](std::uint64_t stream_size) {
+    const auto file = temp_directory_path() / "containerfs_big.ole";
+    write_v4_container(file, stream_size);
+    auto fs = mount<OleDriver>(FileDevice{file});
+    EXPECT_TRUE(fs) << fs.error();
+    EXPECT_TRUE(fs && fs->exists(path{"big"}));
+    const auto size = fs ? fs->file_size("big") : -2;
+    auto lazy = mount<LazyOleDriver>(FileDevice{file});
+    EXPECT_TRUE(lazy) << lazy.error();
+    EXPECT_EQ(lazy ? lazy->file_size("big") : -2, size);
+    remove(file);
+    return size;
+  };
+  EXPECT_EQ(size_of(std::uint64_t{3} << 30), -1);
+  EXPECT_EQ(size_of(std::uint64_t{1} << 32), -1);
+  EXPECT_EQ(size_of(std::numeric_limits<int>::max() + std::uint64_t{1}), -1);
+  EXPECT_EQ(size_of(std::numeric_limits<int>::max()), std::numeric_limits<int>::max());
+}
+
+TEST(ExtentIndex, LocateAndRequests) {
+  // цепочка 3,4,5 -> 10 -> 7,8 из секторов по 512 байт
+  const std::vector<Extent> extents{{3, 3}, {10, 1}, {7, 2}};
+  const ExtentIndex index{extents, 512};
+  ASSERT_EQ(index.size(), 6u * 512);
+
+  EXPECT_EQ(index.locate(0)->first, 3u);
+  EXPECT_EQ(index.locate(3 * 512 - 1)->first, 3u);
+  EXPECT_EQ(index.locate(3 * 512)->first, 10u);
+  EXPECT_EQ(index.locate(5 * 512 + 100)->offset, 4u * 512);
+  EXPECT_EQ(index.locate(6 * 512), index.entries().end());
+
+  // диапазон с середины первого участка до середины последнего: по запросу на участок
+  std::vector<std::byte> buffer(2 * 512 + 512 + 700);
+  std::vector<ReadRequest> requests;
+  ASSERT_TRUE(index.append_requests(512, buffer, requests));
+  ASSERT_EQ(requests.size(), 3u);
+  EXPECT_EQ(requests[0].offset, sector_offset(4, 512));
+  EXPECT_EQ(requests[0].dst.size(), 2u * 512);
+  EXPECT_EQ(requests[1].offset, sector_offset(10, 512));
+  EXPECT_EQ(requests[2].offset, sector_offset(7, 512));
+  EXPECT_EQ(requests[2].dst.size(), 700u);
+
+  requests.clear();
+  EXPECT_FALSE(index.append_requests(6 * 512 - 10, std::span{buffer}.first(11), requests));
+
+  // размер единицы не обрезается до 16 бит
+  const ExtentIndex wide{extents, 1u << 16};
+  requests.clear();
+  ASSERT_TRUE(wide.append_requests(3u << 16, std::span{buffer}.first(10), requests));
+  ASSERT_EQ(requests.size(), 1u);
+  EXPECT_EQ(requests[0].offset, std::uint64_t{11} << 16);
+}
+
+TEST(ValidateFat, DetectsCorruption) {
+  // сектор 0 - FAT, цепочки 1 -> 2 -> 3 и 5 -> 4, сектор 6 свободен; 17 записей, чтобы задеть и векторный, и хвостовой цикл
+  std::vector<fat_t> fat{FATSECT, 2, 3, ENDOFCHAIN, ENDOFCHAIN, 4, FREESECT};
+  fat.resize(17, FREESECT);
+  const std::array<fat_t, 1> fat_sectors{0};
+  EXPECT_EQ(validate_fat(fat, fat_sectors, {}), ole::Error::Success);
+
+  auto corrupt = [&](std::size_t sid, fat_t value) {
+    auto copy = fat;
+    copy[sid] = value;
+    return validate_fat(copy, fat_sectors, {});
+  };
+  EXPECT_EQ(corrupt(16, 17), ole::Error::InvalidFatEntry);         // за пределами FAT, в хвостовом цикле
+  EXPECT_EQ(corrupt(2, 0xFFFFFFFB), ole::Error::InvalidFatEntry);  // зарезервированное, но не определённое значение
+  EXPECT_EQ(corrupt(0, ENDOFCHAIN), ole::Error::InvalidFatEntry);  // FAT-сектор не помечен FATSECT
+  EXPECT_EQ(corrupt(5, 2), ole::Error::FatCrossLinked);            // сектор 2 в двух цепочках
+  EXPECT_EQ(corrupt(6, 0), ole::Error::FatCrossLinked);            // ссылка на сам FAT
+  EXPECT_EQ(corrupt(3, 1), ole::Error::FatChainCycle);             // 1 -> 2 -> 3 -> 1
+  EXPECT_EQ(corrupt(6, 6), ole::Error::FatChainCycle);             // петля
+
+  // без проверки цепочки всё равно не выходят за FAT и не зацикливаются
+  auto cycle = fat;
+  cycle[3] = 1;
+  EXPECT_EQ(sector_chain(cycle, 1).error(), ole::Error::CorruptedFile);
+  EXPECT_EQ(chain_extents(cycle, 1).error(), ole::Error::CorruptedFile);
+  EXPECT_EQ(sector_chain(fat, 100).error(), ole::Error::CorruptedFile);
+  EXPECT_EQ(chain_extents(fat, 1)->size(), 1u); // 1, 2, 3 подряд
+  EXPECT_EQ(*sector_chain(fat, 5), (std::pmr::vector<fat_t>{5, 4}));
+}
+
+TEST(ValidateFat, HostileHeaderCounts) {
+  using namespace std::filesystem;
+
+  // заголовок документа с подменёнными csectFat (0x2C) и csectDif (0x48): ошибка, а не reserve на гигабайты
+  const auto mount_patched = [](std::uint32_t num_fat, std::uint32_t num_difat, auto device_tag) {
+    auto bytes = read_file("nauka_i_osmislenie.doc");
+    std::memcpy(bytes.data() + 0x2C, &num_fat, sizeof(num_fat));
+    std::memcpy(bytes.data() + 0x48, &num_difat, sizeof(num_difat));
+    const auto patched = temp_directory_path() / "containerfs_hostile.doc";
+    std::ofstream{patched, std::ios::binary}.write(reinterpret_cast<const char*>(bytes.data()),
+                                                   static_cast<std::streamsize>(bytes.size()));
+    auto fs = mount<OleDriver>(typename decltype(device_tag)::type{patched});
+    remove(patched);
+    return fs ? ole::Error::Success : fs.error();
+  };
+  const std::type_identity<FileDevice> file;
+  const std::type_identity<MmapDevice> mapped;
+
+  EXPECT_EQ(mount_patched(0xFFFFFFFF, 0, file), ole::Error::CorruptedFile);            // больше, чем 109 записей DIFAT
+  EXPECT_EQ(mount_patched(0xFFFFFFFF, 0, mapped), ole::Error::CorruptedFile);
+  EXPECT_EQ(mount_patched(0xFFFFFFFF, 0xFFFFFFFF, mapped), ole::Error::CorruptedFile);  // больше секторов файла
+  EXPECT_EQ(mount_patched(0xFFFFFFFF, 0xFFFFFFFF, file), ole::Error::CorruptedFile);    // DIFAT-секторов нет
+  EXPECT_EQ(mount_patched(3, 0, mapped), ole::Error::Success);                         // исходные значения
+}
+
+TEST(ValidateDirectory, DetectsCorruptionAndTraversesIteratively) {
+  const auto entry = [](ole::file_type type, std::u16string_view name, std::uint32_t left, std::uint32_t right,
+                        std::uint32_t child) {
+    ole::DirectoryEntry result{};
+    result.type = type;
+    result.name = *ole::String::make(name);
+    result.left_id = left;
+    result.right_id = right;
+    result.child_id = child;
+    return result;
+  };
+  using enum ole::file_type;
+  constexpr auto N = ole::NOSTREAM;
+  // корень -> {A, B, C} с B в вершине, в хранилище A - поток X
+  const std::vector<ole::DirectoryEntry> dirs{
+      entry(root, u"Root Entry", N, N, 2), entry(directory, u"A", N, N, 4), entry(regular, u"B", 1, 3, N),
+      entry(regular, u"C", N, N, N), entry(regular, u"X", N, N, N)};
+  EXPECT_EQ(ole::validate_directory(dirs), ole::Error::Success);
+
+  std::vector<std::u16string> names;
+  for (const auto &e : ole::dir_view(dirs, 2)) {
+    names.emplace_back(e.name.folded());
+  }
+  EXPECT_EQ(names, (std::vector<std::u16string>{u"A", u"B", u"C"}));
+
+  auto corrupt = [&](std::size_t id, auto field, std::uint32_t value) {
+    auto copy = dirs;
+    copy[id].*field = value;
+    return ole::validate_directory(copy);
+  };
+  using E = ole::DirectoryEntry;
+  EXPECT_EQ(corrupt(3, &E::right_id, 2), ole::Error::InvalidDirectoryTree);  // C -> B: цикл
+  EXPECT_EQ(corrupt(4, &E::left_id, 3), ole::Error::InvalidDirectoryTree);   // на C ссылаются дважды
+  EXPECT_EQ(corrupt(1, &E::right_id, 5), ole::Error::InvalidDirectoryTree);  // за пределами каталога
+  EXPECT_EQ(corrupt(3, &E::child_id, 4), ole::Error::InvalidDirectoryTree);  // дети у потока
+  EXPECT_EQ(corrupt(0, &E::left_id, 1), ole::Error::InvalidDirectoryTree);   // соседи у корня
+  // поиск по непроверенному каталогу: цикл и ссылка за его пределы дают "не найдено"
+  const ole::PathView missing{u"Z"};
+  const ole::PathView nested{u"A/X"};
+  EXPECT_EQ(std::ranges::distance(ole::PathResolve(dirs, nested, 2)), 2);
+  auto looped = dirs;
+  looped[3].right_id = 2;
+  EXPECT_EQ(std::ranges::distance(ole::PathResolve(looped, missing, 2)), 0);
+  looped[3].right_id = 5;
+  EXPECT_EQ(std::ranges::distance(ole::PathResolve(looped, missing, 2)), 0);
+  looped[1].child_id = 1'000;
+  EXPECT_EQ(std::ranges::distance(ole::PathResolve(looped, nested, 2)), 1);
+
+  auto free_entry = dirs;
+  free_entry[4].type = unknown_or_unallocated;
+  EXPECT_EQ(ole::validate_directory(free_entry), ole::Error::InvalidDirectoryTree);
+
+  // вырожденное дерево в 100000 уровней обходится без рекурсии, а цикл в нём обрывает обход
+  std::vector<ole::DirectoryEntry> chain{entry(root, u"Root Entry", N, N, 100'000)};
+  for (std::uint32_t i = 1; i <= 100'000; ++i) {
+    chain.push_back(entry(regular, u"s", i - 1 == 0 ? N : i - 1, N, N));
+  }
+  chain[0].child_id = 100'000;
+  EXPECT_EQ(ole::validate_directory(chain), ole::Error::Success);
+  EXPECT_EQ(std::ranges::distance(ole::dir_view(chain, 100'000)), 100'000);
+
+  chain[1].left_id = 100'000;
+  EXPECT_EQ(ole::validate_directory(chain), ole::Error::InvalidDirectoryTree);
+  EXPECT_LE(std::ranges::distance(ole::dir_view(chain, 100'000)), static_cast<std::ptrdiff_t>(chain.size()));
+}
+
+static_assert(ReadableDevice<OleStreamDevice<FileDevice>>);
+static_assert(not ConcurrentReadableDevice<OleStreamDevice<FileDevice>>);
+static_assert(ConcurrentReadableDevice<OleStreamDevice<MmapDevice>>);
+
+TEST(OleStreamDevice, MatchesReadFile) {
+  auto fs = mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(fs) << fs.error();
+
+  for (const auto* name : {"WordDocument", "1Table", "\1CompObj"}) {
+    const auto expected = fs->read_file(name);
+    auto stream = fs->open_stream(name);
+    ASSERT_TRUE(stream) << name;
+    ASSERT_EQ(stream->size(), expected.size()) << name;
+
+    // диапазоны через границы секторов и мини-секторов, включая хвост потока
+    for (const std::size_t step : {1u, 63u, 511u, 4097u}) {
+      for (std::size_t off = 0; off < expected.size(); off += step * 7 + 1) {
+        std::vector<std::byte> chunk(std::min(step, expected.size() - off));
+        ASSERT_TRUE(stream->read_at(off, chunk)) << name << " @" << off;
+        ASSERT_TRUE(std::ranges::equal(chunk, std::span{expected}.subspan(off, chunk.size()))) << name << " @" << off;
+      }
+    }
+
+    std::vector<std::byte> past_end(2);
+    EXPECT_FALSE(stream->read_at(expected.size() - 1, past_end)) << name;
+  }
+
+  EXPECT_EQ(fs->open_stream("nonexistent").error(), ole::Error::NotAStream);
+
+  // вложенный контейнер монтируется прямо поверх потока; здесь внутри не OLE
+  auto nested = mount<OleDriver>(*fs->open_stream("WordDocument"));
+  ASSERT_FALSE(nested);
+  EXPECT_EQ(nested.error(), ole::Error::InvalidSignature);
+}
+
+static_assert(PrefetchableDevice<PosixFileDevice>);
+static_assert(PrefetchableDevice<MmapDevice>);
+static_assert(not PrefetchableDevice<FileDevice>);
+static_assert(not PrefetchableDevice<OleStreamDevice<FileDevice>>);
+
+// Запоминает подсказки prefetch, чтобы проверить упреждающее чтение
+struct PrefetchRecorder {
+  PosixFileDevice dev;
+  std::shared_ptr<std::vector<std::pair<std::uint64_t, std::uint64_t>>> hints =
+      std::make_shared<std::vector<std::pair<std::uint64_t, std::uint64_t>>>();
+
+  bool read_at(std::uint64_t off, std::span<std::byte> dst) { return dev.read_at(off, dst); }
+  void prefetch(std::uint64_t off, std::uint64_t size) {
+    hints->emplace_back(off, size);
+    dev.prefetch(off, size);
+  }
+};
+
+TEST(OleStreamDevice, SequentialReadAhead) {
+  PrefetchRecorder dev{PosixFileDevice{"nauka_i_osmislenie.doc"}};
+  const auto hints = dev.hints;
+  auto fs = mount<OleDriver>(std::move(dev));
+  ASSERT_TRUE(fs) << fs.error();
+  const auto expected = fs->read_file("WordDocument");
+
+  // чтения назад маленькими кусками внутри сектора: упреждать нечего
+  auto stream = *fs->open_stream("WordDocument");
+  stream.set_read_ahead(16);
+  std::vector<std::byte> chunk(100);
+  hints->clear();
+  for (std::uint64_t off : {50000, 43000, 36000, 29000, 1000}) {
+    ASSERT_TRUE(stream.read_at(off, chunk)) << off;
+  }
+  EXPECT_TRUE(hints->empty());
+
+  // последовательное чтение: подсказки идут впереди чтения, окно двигается порциями
+  auto sequential = *fs->open_stream("WordDocument");
+  sequential.set_read_ahead(16);
+  std::vector<std::byte> content(expected.size());
+  for (std::size_t off = 0; off < content.size(); off += chunk.size()) {
+    const auto part = std::span{content}.subspan(off, std::min(chunk.size(), content.size() - off));
+    ASSERT_TRUE(sequential.read_at(off, part));
+  }
+  EXPECT_EQ(content, expected);
+  EXPECT_FALSE(hints->empty());
+  // окно покрывает поток, а подсказок намного меньше, чем чтений
+  std::uint64_t hinted = 0;
+  for (const auto& [off, size] : *hints) {
+    hinted += size;
+  }
+  EXPECT_GE(hinted, expected.size() - 16 * 512);
+  EXPECT_LT(hints->size(), content.size() / chunk.size() / 4);
+}
+
+TEST(ReadFileAsync, IoUringDevice) {
+  auto fs = mount<OleDriver>(IoUringDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(fs) << fs.error();
+  auto sync = mount<OleDriver>(FileDevice{"nauka_i_osmislenie.doc"});
+  ASSERT_TRUE(sync) << sync.error();
+
+  // FAT-потоки уходят в кольцо пачками по участкам, \1CompObj - из мини-потока
+  std::vector<std::pair<const char*, std::future<std::vector<std::byte>>>> pending;
+  for (const auto* name : kWordStreams) {
+    auto promise = std::make_shared<std::promise<std::vector<std::byte>>>();
+    pending.emplace_back(name, promise->get_future());
+    fs->read_file_async(name, [promise](std::vector<std::byte> data) { promise->set_value(std::move(data)); });
+  }
+
+  for (auto& [name, result] : pending) {
+    const auto expected = sync->read_file(name);
+    ASSERT_FALSE(expected.empty()) << name;
+    EXPECT_EQ(result.get(), expected) << name;
+  }
+}
+
+TEST(ReadManyAsync, SmallQueueDepth) {
+  using namespace std::filesystem;
+
+  const path file{"exists.ole"};
+  std::vector<std::byte> expected(file_size(file));
+  ASSERT_TRUE(FileDevice{file}.read_at(0, expected));
+
+  const IoUringDevice dev{file, 4};
+  std::vector<std::byte> actual(expected.size());
+  std::vector<ReadRequest> requests;
+  for (std::size_t off = 0; off < expected.size(); off += 64) {
+    requests.push_back({off, std::span{actual}.subspan(off, std::min<std::size_t>(64, expected.size() - off))});
+  }
+
+  std::promise<bool> done;
+  read_many_async(dev, requests, [&done](bool ok) { done.set_value(ok); });
+  EXPECT_TRUE(done.get_future().get());
+  EXPECT_EQ(actual, expected);
+
+  // синхронное устройство выполняет пачку сразу
+  std::promise<bool> sync_done;
+  FileDevice sync{file};
+  read_many_async(sync, requests, [&sync_done](bool ok) { sync_done.set_value(ok); });
+  EXPECT_TRUE(sync_done.get_future().get());
+}
+
 TEST(OLETest, DISABLED_ReadSmallFile) {
   const std::filesystem::path file{"test.ole"};
   EXPECT_TRUE(exists(file));